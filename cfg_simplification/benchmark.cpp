@@ -0,0 +1,83 @@
+#include <stdlib.h>
+
+#include "../common/analyses_time.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/interpreter.h"
+#include "../common/stefanos.h"
+
+#include "simplify_cfg.h"
+
+/* Benchmark utilities */
+
+// Like generated code: Half of the blocks (except the entry) are emptied, so
+// that the ones with a single successor only forward, and the rest have
+// chains of jumps in them.
+static
+CFG generate(CFG (*gen)(int), int nelems, int nregs, int ninsts) {
+ CFG cfg = gen(nelems);
+ srand(nelems);
+ populate_cfg(cfg, nregs, ninsts);
+ for (BasicBlock &bb : cfg.bbs) {
+   if (bb.num == 0 || rand() % 2)
+     continue;
+   auto *node = bb.insts.head;
+   while (node) {
+     Instruction *inst = (Instruction *) node;
+     node = node->next;
+     if (inst == bb.terminator())
+       continue;
+     inst->unlink();
+     delete inst;
+   }
+ }
+ return cfg;
+}
+
+// The simplification and then the time of the analyses before and after it.
+// The output must stay the same.
+static
+void simplify_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 2000, 4000, 8000, 16000 };
+ int nregs = 16, ninsts = 8;
+ int64_t max_steps = 1000000;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG orig = generate(gen, set[i], nregs, ninsts);
+   CFG cfg = generate(gen, set[i], nregs, ninsts);
+   int max_reg = nregs - 1;
+   int nbbs = cfg.size();
+
+   double time_taken;
+   SimplifyStats stats;
+   TIME_STMT(stats = simplify_cfg(&cfg), time_taken);
+
+   // The removed jumps were steps too, so `after` may get further.
+   InterpResult before = interpret(orig, max_reg, max_steps);
+   InterpResult after = interpret(cfg, max_reg, max_steps);
+   assert(same_output(before, after));
+   before.free();
+   after.free();
+
+   double dtree_before, live_before, dtree_after, live_after;
+   analyses_time(orig, max_reg, &dtree_before, &live_before);
+   analyses_time(cfg, max_reg, &dtree_after, &live_after);
+   printf("Benchmark Simplify: %d elements: %.4lfs (blocks: %d -> %d, %d "
+          "collapsed, %d threaded, %d merged)\n", set[i], time_taken, nbbs,
+          (int) cfg.size(), stats.collapsed, stats.threaded, stats.merged);
+   printf("  Dominator tree: %.4lfs -> %.4lfs, liveness: %.4lfs -> %.4lfs\n",
+          dtree_before, dtree_after, live_before, live_after);
+   cfg.destruct();
+   orig.destruct();
+ }
+ printf("\n");
+}
+
+int main() {
+  simplify_benchmark("Linear", linear_cfg);
+  simplify_benchmark("FwdBack", fwdback_cfg);
+  simplify_benchmark("DeepLoops", deep_loops_cfg);
+  simplify_benchmark("Irreducible", irreducible_cfg);
+
+  return 0;
+}
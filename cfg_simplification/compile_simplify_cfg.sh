@@ -0,0 +1,2 @@
+g++ simplify_cfg.cpp -o simplify_cfg
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
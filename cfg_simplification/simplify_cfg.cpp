@@ -0,0 +1,21 @@
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+
+#include "simplify_cfg.h"
+
+// Usage: simplify_cfg file
+// Simplifies the CFG (see simplify_cfg.h) and prints the result and what
+// changed.
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  CFG cfg = parse_procedure(argv[1], NULL);
+  int nbbs = cfg.size();
+  SimplifyStats stats = simplify_cfg(&cfg);
+  cfg.print();
+  printf("Blocks: %d -> %d (%d collapsed, %d threaded, %d merged, "
+         "%d removed)\n", nbbs, (int) cfg.size(), stats.collapsed,
+         stats.threaded, stats.merged, stats.removed);
+  cfg.destruct();
+}
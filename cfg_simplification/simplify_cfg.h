@@ -0,0 +1,265 @@
+#ifndef SIMPLIFY_CFG_H
+#define SIMPLIFY_CFG_H
+
+#include <string.h>
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+#include "../common/traversal.h"
+
+/*
+CFG simplification. Generated code has many blocks that only jump somewhere
+else and long chains of blocks, and every analysis pays for them. In order:
+
+1) `BR %c, .x, .x` becomes `BR .x` (collapse).
+2) Jump threading: A block that has only `BR .t` (a forwarder) is skipped,
+   i.e. every branch to it goes to `.t` (to where a chain of forwarders
+   ends). A cycle of forwarders (an empty infinite loop) becomes a block
+   that jumps to itself. The forwarders become unreachable. This can create
+   more `BR %c, .x, .x`, so we collapse again.
+3) Merging: If `A` ends with `BR .B` and `A` is the only predecessor of `B`,
+   the instructions of `B` are moved to the end of `A` (in place of the
+   jump), and `B` becomes unreachable. In RPO, so that a chain is merged into
+   its first block.
+4) The unreachable blocks are removed and the rest are renumbered in the
+   same order (the entry stays 0), so that `num` is dense (e.g. the output
+   can be parsed again).
+
+The branches are the truth: the passes change only the labels of the
+branches and `succs` / `preds` are rebuilt in bulk from them
+(`simplify_rebuild_edges()`) between the passes, not edge by edge.
+
+The entry is never skipped or merged into another block. It's not meant for
+SSA (there are no phis to fix).
+
+The number of blocks changes, so it takes a pointer to the CFG: the copies
+of a CFG share `bbs.data`, but not the length.
+*/
+
+typedef struct SimplifyStats {
+  // `BR %c, .x, .x` that became jumps
+  int collapsed;
+  // Branch labels that skip forwarders
+  int threaded;
+  // Blocks that were merged into their predecessor
+  int merged;
+  // Blocks removed (unreachable, including the ones from the above)
+  int removed;
+} SimplifyStats;
+
+// Call `f(int *lbl)` on every label of the branch of `bb`, if any.
+template <typename F>
+static
+void simplify_for_each_label(BasicBlock *bb, F f) {
+  Instruction *term = bb->terminator();
+  if (!term)
+    return;
+  if (term->kind == INST::BR_UNCOND) {
+    f(&term->uncond_lbl);
+  } else {
+    f(&term->then);
+    f(&term->els);
+  }
+}
+
+// Set `succs` and `preds` of every block from the branches.
+static
+void simplify_rebuild_edges(CFG cfg) {
+  for (BasicBlock &bb : cfg.bbs) {
+    bb.succs.clear();
+    bb.preds.clear();
+  }
+  for (BasicBlock &bb : cfg.bbs) {
+    int b = bb.num;
+    simplify_for_each_label(&bb, [&cfg, b](int *lbl) {
+      cfg.bbs[b].succs.push(*lbl);
+      cfg.bbs[*lbl].preds.push(b);
+    });
+  }
+  cfg.invalidate_traversals();
+}
+
+static
+int simplify_collapse(CFG cfg) {
+  int collapsed = 0;
+  for (BasicBlock &bb : cfg.bbs) {
+    Instruction *term = bb.terminator();
+    if (!term || term->kind != INST::BR_COND || term->then != term->els)
+      continue;
+    Instruction *jump = Instruction::br_uncond(term->then);
+    jump->set_parent(&bb);
+    term->insert_before(jump);
+    term->unlink();
+    delete term;
+    ++collapsed;
+  }
+  return collapsed;
+}
+
+static
+bool simplify_is_forwarder(const BasicBlock &bb) {
+  return bb.num != 0 && bb.insts.size == 1 &&
+         ((Instruction *) bb.insts.head)->kind == INST::BR_UNCOND;
+}
+
+static
+int simplify_thread(CFG cfg) {
+  int nbbs = cfg.size();
+  // Where a label to `b` should go.
+  Buf<int> target;
+  target.reserve_and_set(nbbs);
+  // 0: not resolved, 1: on the current chain, 2: resolved
+  Buf<char> state;
+  state.reserve_and_set(nbbs);
+  memset(state.data, 0, nbbs * sizeof(char));
+  Buf<int> chain;
+  LOOP(b, 0, nbbs) {
+    if (state[b])
+      continue;
+    chain.clear();
+    int x = b;
+    while (simplify_is_forwarder(cfg.bbs[x]) && state[x] == 0) {
+      state[x] = 1;
+      chain.push(x);
+      x = ((Instruction *) cfg.bbs[x].insts.head)->uncond_lbl;
+    }
+    // `x` is where the chain ends, unless it's resolved already. If it's on
+    // the chain, the chain ends in a cycle and `x` jumps to itself.
+    int t = (state[x] == 2) ? target[x] : x;
+    for (int c : chain) {
+      target[c] = t;
+      state[c] = 2;
+    }
+    if (state[x] == 0) {
+      target[x] = x;
+      state[x] = 2;
+    }
+  }
+  int threaded = 0;
+  for (BasicBlock &bb : cfg.bbs) {
+    simplify_for_each_label(&bb, [&target, &threaded](int *lbl) {
+      if (target[*lbl] != *lbl) {
+        *lbl = target[*lbl];
+        ++threaded;
+      }
+    });
+  }
+  chain.free();
+  state.free();
+  target.free();
+  return threaded;
+}
+
+// The edges must be up to date.
+static
+int simplify_merge(CFG cfg) {
+  int nbbs = cfg.size();
+  const Buf<int> post_num = cfg_postorder_numbers(cfg);
+  // The predecessors of every block that are reachable (counting an edge
+  // twice if it's there twice). It stays correct while merging: the edges
+  // of `B` become edges of `A`, which is reachable too.
+  Buf<int> npreds;
+  npreds.reserve_and_set(nbbs);
+  LOOP(b, 0, nbbs) {
+    npreds[b] = 0;
+    for (int pred : cfg.bbs[b].preds) {
+      npreds[b] += post_num[pred] != -1;
+    }
+  }
+  Buf<bool> merged_away;
+  merged_away.reserve_and_set(nbbs);
+  memset(merged_away.data, 0, nbbs * sizeof(bool));
+  int merged = 0;
+  for (int a : cfg_rpo(cfg)) {
+    if (merged_away[a])
+      continue;
+    BasicBlock *bb = &cfg.bbs[a];
+    while (true) {
+      Instruction *term = bb->terminator();
+      if (!term || term->kind != INST::BR_UNCOND)
+        break;
+      int b = term->uncond_lbl;
+      if (b == 0 || b == a || npreds[b] != 1)
+        break;
+      term->unlink();
+      delete term;
+      BasicBlock *from = &cfg.bbs[b];
+      while (from->insts.head) {
+        Instruction *inst = (Instruction *) from->insts.head;
+        inst->unlink();
+        bb->insert_inst_at_end(inst);
+      }
+      merged_away[b] = true;
+      ++merged;
+    }
+  }
+  merged_away.free();
+  npreds.free();
+  return merged;
+}
+
+// Remove the unreachable blocks and renumber the rest. The edges must be up
+// to date and they're rebuilt.
+static
+int simplify_remove_unreachable(CFG *cfg) {
+  int nbbs = cfg->size();
+  const Buf<int> post_num = cfg_postorder_numbers(*cfg);
+  Buf<int> new_num;
+  new_num.reserve_and_set(nbbs);
+  int nkept = 0;
+  LOOP(b, 0, nbbs) {
+    new_num[b] = (post_num[b] != -1) ? nkept++ : -1;
+  }
+  if (nkept == nbbs) {
+    new_num.free();
+    return 0;
+  }
+  LOOP(b, 0, nbbs) {
+    BasicBlock *bb = &cfg->bbs[b];
+    if (new_num[b] == -1) {
+      auto *node = bb->insts.head;
+      while (node) {
+        Instruction *inst = (Instruction *) node;
+        node = node->next;
+        delete inst;
+      }
+      bb->succs.free();
+      bb->preds.free();
+      continue;
+    }
+    // Labels of reachable blocks point only to reachable blocks.
+    simplify_for_each_label(bb, [&new_num](int *lbl) {
+      *lbl = new_num[*lbl];
+    });
+    if (new_num[b] == b)
+      continue;
+    BasicBlock *to = &cfg->bbs[new_num[b]];
+    *to = *bb;
+    to->num = new_num[b];
+    for (Instruction *inst : to->insts) {
+      inst->set_parent(to);
+    }
+  }
+  cfg->bbs.resize(nkept);
+  simplify_rebuild_edges(*cfg);
+  new_num.free();
+  return nbbs - nkept;
+}
+
+static
+SimplifyStats simplify_cfg(CFG *cfg) {
+  SimplifyStats stats = {0, 0, 0, 0};
+  if (!cfg->size())
+    return stats;
+  stats.collapsed = simplify_collapse(*cfg);
+  stats.threaded = simplify_thread(*cfg);
+  stats.collapsed += simplify_collapse(*cfg);
+  simplify_rebuild_edges(*cfg);
+  stats.merged = simplify_merge(*cfg);
+  simplify_rebuild_edges(*cfg);
+  stats.removed = simplify_remove_unreachable(cfg);
+  return stats;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ANALYSES_TIME_H
+#define ANALYSES_TIME_H
+
+#include "cfg.h"
+#include "stefanos.h"
+#include "../dominance/dtree.h"
+#include "../live_information/liveout.h"
+
+// For the benchmarks of the transformations that shrink the CFG or the code
+// (e.g. /constant_propagation, /cfg_simplification): the time of the
+// dominator tree and of liveness on `cfg`, to compare before and after.
+static
+void analyses_time(CFG cfg, int max_register, double *dtree_time_taken,
+                   double *live_time_taken) {
+  DominatorTree dtree(cfg.size());
+  TIME_STMT(dtree.build(cfg), *dtree_time_taken);
+  dtree.free();
+  LiveInfo live;
+  TIME_STMT(live = liveness(cfg, max_register), *live_time_taken);
+  live.free();
+}
+
+#endif
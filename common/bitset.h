@@ -16,6 +16,12 @@ static BitSet64 bset64_add(BitSet64 bset, int elem) {
   return bset;
 }
 
+static BitSet64 bset64_remove(BitSet64 bset, int elem) {
+  assert(elem < MAX_ELEM);
+  bset &= ~(1UL << elem);
+  return bset;
+}
+
 static int bset64_is_in(BitSet64 bset, int elem) {
   assert(elem < MAX_ELEM);
   // This right shift is actually needed otherwise
@@ -27,7 +33,7 @@ static int bset64_eq(BitSet64 bset1, BitSet64 bset2) {
   return (bset1 == bset2);
 }
 
-static int bset64_not(BitSet64 bset) { return ~bset; }
+static BitSet64 bset64_not(BitSet64 bset) { return ~bset; }
 
 // We know the underlying sets, i.e. BitSet64, are 64-bit.
 #define WORD_SIZE 64
@@ -75,6 +81,12 @@ static void bset_add(BitSet bset, int elem) {
   bset.data[sub.index] = bset64_add(bset.data[sub.index], sub.elem);
 }
 
+static void bset_remove(BitSet bset, int elem) {
+  assert(elem < bset.max_elems);
+  SubBitset sub = compute_sub_bitset(elem);
+  bset.data[sub.index] = bset64_remove(bset.data[sub.index], sub.elem);
+}
+
 static int bset_is_in(BitSet bset, int elem) {
   assert(elem < bset.max_elems);
   SubBitset sub = compute_sub_bitset(elem);
@@ -97,6 +109,10 @@ static int bset_copy(BitSet a, BitSet b) {
 
 static void bset_free(BitSet bset) { free(bset.data); }
 
+static void bset_clear(BitSet bset) {
+  memset(bset.data, 0, num_words(bset.max_elems) * sizeof(BitSet64));
+}
+
 static void light_all(BitSet bset) {
   memset(bset.data, 0xff, num_words(bset.max_elems) * sizeof(BitSet64));
 }
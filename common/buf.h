@@ -63,6 +63,14 @@ public:
     _len = n;
   }
 
+  // Set the length to `n`, growing if needed. New elements are
+  // uninitialized.
+  void resize(size_t n) {
+    if (n > cap)
+      _grow(n);
+    _len = n;
+  }
+
   ssize_t len() const {
     return _len;
   }
@@ -76,6 +84,7 @@ public:
   void free() {
     if (data != nullptr)
       ::free(data);
+    data = nullptr;
     _len = 0;
     cap = 0;
   }
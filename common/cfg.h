@@ -59,11 +59,13 @@ Value val_strip_kind(Value v) {
   return v & (~MSB);
 }
 
+// If `reg_names` is not NULL, register `r` is printed as `reg_names[r]`
+// (e.g. the original names after compaction, see reg_compaction.h).
 static
-void val_print(Value v) {
+void val_print(Value v, const uint32_t *reg_names = NULL) {
   Value strip = val_strip_kind(v);
   if (val_kind(v) == VAL_REG) {
-    printf("%%%u", strip);
+    printf("%%%u", reg_names ? reg_names[strip] : strip);
   } else {
     printf("%u", strip);
   }
@@ -81,12 +83,18 @@ Operation op_add(Value lhs, Value rhs) {
   return o;
 }
 
+// Values are 31-bit, so an ADD wraps around modulo 2^31.
 static
-void op_print(Operation op) {
-  val_print(op.lhs);
+uint32_t imm_add(uint32_t a, uint32_t b) {
+  return (a + b) & ~MSB;
+}
+
+static
+void op_print(Operation op, const uint32_t *reg_names = NULL) {
+  val_print(op.lhs, reg_names);
   if (op.kind == OP_ADD) {
     printf(" + ");
-    val_print(op.rhs);
+    val_print(op.rhs, reg_names);
   }
 }
 
@@ -95,6 +103,7 @@ enum class INST {
   PRINT,
   BR_COND,
   BR_UNCOND,
+  PHI,
 };
 
 struct BasicBlock;
@@ -123,6 +132,9 @@ struct Instruction : ListNode<Instruction, BasicBlock> {
       int els;
     };
   };
+  // Only for PHI: One Value for every predecessor of the parent,
+  // in the same order as `parent->preds`.
+  Buf<Value> phi_args;
 
   static Instruction *def(uint32_t reg, Operation op) {
     Instruction *i = new Instruction;
@@ -155,12 +167,25 @@ struct Instruction : ListNode<Instruction, BasicBlock> {
     return i;
   }
 
-  void print_out() {
+  // `npreds` arguments are allocated but not initialized.
+  static Instruction *phi(uint32_t reg, int npreds) {
+    Instruction *i = new Instruction;
+    i->kind = INST::PHI;
+    i->reg = reg;
+    i->phi_args.reserve_and_set(npreds);
+    return i;
+  }
+
+  void print_out(const uint32_t *reg_names = NULL) {
     printf("  ");
     switch (kind) {
     case INST::DEF:
-      printf("%%%u <- ", reg);
+      printf("%%%u <- ", reg_names ? reg_names[reg] : reg);
       break;
+    case INST::PHI:
+      printf("%%%u <- PHI ", reg_names ? reg_names[reg] : reg);
+      print_phi_args(reg_names);
+      return;
     case INST::PRINT:
       printf("PRINT ");
       break;
@@ -169,14 +194,17 @@ struct Instruction : ListNode<Instruction, BasicBlock> {
       return;
     case INST::BR_COND:
       printf("BR ");
-      val_print(cond_val);
+      val_print(cond_val, reg_names);
       printf(", .%d, .%d\t", then, els);
       return;
     default:
       assert(0);
     }
-    op_print(op);
+    op_print(op, reg_names);
   }
+
+  // Defined after BasicBlock.
+  void print_phi_args(const uint32_t *reg_names = NULL);
 };
 
 struct BasicBlock {
@@ -205,7 +233,33 @@ struct BasicBlock {
     insts.insert_at_end(inst);
   }
 
-  void print() {
+  void insert_inst_at_beginning(Instruction *inst) {
+    inst->set_parent(this);
+    insts.insert_at_beginning(inst);
+  }
+
+  // Return the branch at the end of the block, if any.
+  Instruction *terminator() const {
+    if (!insts.tail)
+      return nullptr;
+    Instruction *last = (Instruction *) insts.tail;
+    if (last->kind == INST::BR_COND || last->kind == INST::BR_UNCOND)
+      return last;
+    return nullptr;
+  }
+
+  // Insert `inst` at the end of the block but before its terminator.
+  void insert_inst_before_terminator(Instruction *inst) {
+    Instruction *term = terminator();
+    inst->set_parent(this);
+    if (term) {
+      term->insert_before(inst);
+    } else {
+      insts.insert_at_end(inst);
+    }
+  }
+
+  void print(const uint32_t *reg_names = NULL) {
 #define BIG_INDENT \
     for (int i = 0; i < 25; ++i) \
       printf(" ");
@@ -228,7 +282,7 @@ struct BasicBlock {
     }
     printf("\n");
     for (Instruction *inst : insts) {
-      inst->print_out();
+      inst->print_out(reg_names);
       printf("\n");
     }
 
@@ -236,11 +290,46 @@ struct BasicBlock {
   }
 };
 
+// Print as: [<value>, .<pred>], ...
+inline
+void Instruction::print_phi_args(const uint32_t *reg_names) {
+  LOOP(j, 0, phi_args.len()) {
+    if (j)
+      printf(", ");
+    printf("[");
+    val_print(phi_args[j], reg_names);
+    printf(", .%d]", parent->preds[j]);
+  }
+}
+
+// Traversal orders cached on a CFG (see traversal.h).
+struct TraversalCache {
+  bool valid;
+  Buf<int> postorder;
+  Buf<int> rpo;
+  // Position of every block in `postorder` (-1 if unreachable)
+  Buf<int> post_num;
+
+  TraversalCache() {
+    valid = false;
+  }
+
+  void free() {
+    postorder.free();
+    rpo.free();
+    post_num.free();
+  }
+};
+
 // TODO: Since basic blocks are identified by ID, which is
 // an integer, it might be good to make a custom type, like
 // BasicBlockID or sth. and just use `int`.
 struct CFG {
   Buf<BasicBlock> bbs;
+  // On the heap, so that it's shared by all the (shallow) copies
+  // of the CFG. It's invalidated when an edge is added; if you change
+  // `preds` / `succs` directly, call `invalidate_traversals()`.
+  TraversalCache *trav_cache;
 
   CFG(size_t nbbs) {
     bbs.reserve_and_set(nbbs);
@@ -248,6 +337,7 @@ struct CFG {
     LOOP(i, 0, bbs.len()) {
       bbs[i].num = i;
     }
+    trav_cache = new TraversalCache();
   }
 
   void destruct() {
@@ -256,6 +346,13 @@ struct CFG {
       bb.succs.free();
     }
     bbs.free();
+    trav_cache->free();
+    delete trav_cache;
+    trav_cache = NULL;
+  }
+
+  void invalidate_traversals() {
+    trav_cache->valid = false;
   }
 
   // Add edges b -> [succs], where b is indexed basic block
@@ -265,6 +362,7 @@ struct CFG {
     BasicBlock *bb = &(this->bbs[b]);
     assert(bb->succs.len() == 0);
     bb->succs.reserve(succs.len());
+    invalidate_traversals();
     for (int succ : succs) {
       assert(succ < this->size());
       bb->succs.push(succ);
@@ -275,6 +373,7 @@ struct CFG {
   void add_edge(int source, int dest) {
     assert(source < this->size());
     assert(dest < this->size());
+    invalidate_traversals();
     this->bbs[source].succs.push(dest);
     this->bbs[dest].preds.push(source);
   }
@@ -283,9 +382,9 @@ struct CFG {
     return bbs.len();
   }
 
-  void print() {
+  void print(const uint32_t *reg_names = NULL) {
     for (BasicBlock bb : bbs) {
-      bb.print();
+      bb.print(reg_names);
       printf("\n");
     }
   }
@@ -343,4 +442,76 @@ CFG manypred_cfg(int nelems) {
  return cfg;
 }
 
+// Loops nested as deep as possible: a chain BB_0 -> ... -> BB_{n-1} and
+// the back edges BB_{n-1-i} -> BB_i for 1 <= i < n/2.
+static
+CFG deep_loops_cfg(int nelems) {
+ CFG cfg(nelems);
+ LOOP(i, 0, nelems - 1) { cfg.add_edge(i, i + 1); }
+ LOOP(i, 1, nelems / 2) { cfg.add_edge(nelems - 1 - i, i); }
+ return cfg;
+}
+
+// Groups of 3 blocks a, b, c where a -> b, a -> c, b <-> c and c goes on
+// to the next group. So, every {b, c} is an irreducible loop.
+static
+CFG irreducible_cfg(int nelems) {
+ CFG cfg(nelems);
+ LOOP(i, 0, nelems - 1) {
+   switch (i % 3) {
+   case 0:
+     cfg.add_edge(i, i + 1);
+     if (i + 2 < nelems) {
+       cfg.add_edge(i, i + 2);
+     }
+     break;
+   case 1:
+     cfg.add_edge(i, i + 1);
+     break;
+   case 2:
+     cfg.add_edge(i, i - 1);
+     cfg.add_edge(i, i + 1);
+     break;
+   default:
+     assert(0);
+   }
+ }
+ return cfg;
+}
+
+// Fill every block of a generated CFG with `ninsts` (pseudo-random, see
+// srand()) instructions over the registers [0, nregs) and a branch that agrees
+// with its succs (there must be at most 2). About half of the instructions are
+// DEFs and half PRINTs, so that registers are both used and killed.
+static
+void populate_cfg(CFG cfg, int nregs, int ninsts) {
+ for (BasicBlock &bb : cfg.bbs) {
+   LOOP(i, 0, ninsts) {
+     Value lhs = (rand() % 4) ? val_reg(rand() % nregs) : val_imm(rand() % 100);
+     if (rand() % 2) {
+       bb.insert_inst_at_end(Instruction::print(op_simple(lhs)));
+       continue;
+     }
+     Operation op = op_simple(lhs);
+     if (rand() % 2) {
+       op = op_add(lhs, val_reg(rand() % nregs));
+     }
+     bb.insert_inst_at_end(Instruction::def(rand() % nregs, op));
+   }
+   switch (bb.succs.len()) {
+   case 0:
+     break;
+   case 1:
+     bb.insert_inst_at_end(Instruction::br_uncond(bb.succs[0]));
+     break;
+   case 2:
+     bb.insert_inst_at_end(Instruction::br_cond(val_reg(rand() % nregs),
+                                                bb.succs[0], bb.succs[1]));
+     break;
+   default:
+     assert(0);
+   }
+ }
+}
+
 #endif
@@ -0,0 +1,109 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <string.h>
+#include "buf.h"
+#include "cfg.h"
+#include "stefanos.h"
+
+/*
+A reference interpreter for the IR, to check that a transformation didn't
+change what a procedure does (e.g. compare the output of the original and
+the register-allocated code) and to count the instructions executed.
+
+Semantics:
+- Execution starts at the entry block and ends at a block without a branch.
+- All registers start at 0 (so a use before any definition reads 0).
+- Values are 31-bit (like the immediates; see `val_imm()`), so an ADD wraps
+  around modulo 2^31 (see `imm_add()`).
+- `BR %c, .x, .y` goes to `.x` if `%c` is not 0, otherwise to `.y`.
+- The output is the sequence of the values PRINTed.
+
+It doesn't handle PHIs. Since a procedure may not terminate, it executes at
+most `max_steps` instructions.
+*/
+
+typedef struct InterpResult {
+  Buf<uint32_t> output;
+  // Instructions executed.
+  int64_t steps;
+  // False if it ran out of steps.
+  bool finished;
+
+  void free() {
+    output.free();
+  }
+} InterpResult;
+
+static
+InterpResult interpret(CFG cfg, int max_register, int64_t max_steps) {
+  InterpResult res;
+  res.steps = 0;
+  res.finished = true;
+  if (!cfg.size())
+    return res;
+  int nregs = max_register + 1;
+  Buf<uint32_t> regs;
+  regs.reserve_and_set(nregs);
+  memset(regs.data, 0, nregs * sizeof(uint32_t));
+  auto eval = [&regs](Value v) -> uint32_t {
+    return (val_kind(v) == VAL_REG) ? regs[val_strip_kind(v)] : val_strip_kind(v);
+  };
+  auto eval_op = [&eval](Operation op) -> uint32_t {
+    uint32_t res = eval(op.lhs);
+    if (op.kind == OP_ADD) {
+      res = imm_add(res, eval(op.rhs));
+    }
+    return res;
+  };
+
+  int bb = 0;
+  while (bb != -1) {
+    int next = -1;
+    for (Instruction *inst : cfg.bbs[bb].insts) {
+      if (res.steps == max_steps) {
+        res.finished = false;
+        regs.free();
+        return res;
+      }
+      ++res.steps;
+      switch (inst->kind) {
+      case INST::DEF:
+        regs[inst->reg] = eval_op(inst->op);
+        break;
+      case INST::PRINT:
+        res.output.push(eval_op(inst->op));
+        break;
+      case INST::BR_COND:
+        next = eval(inst->cond_val) ? inst->then : inst->els;
+        break;
+      case INST::BR_UNCOND:
+        next = inst->uncond_lbl;
+        break;
+      default:
+        assert(0);
+      }
+    }
+    bb = next;
+  }
+  regs.free();
+  return res;
+}
+
+// Did `a` and `b` print the same? The runs may stop at different points (a
+// procedure may not terminate and a transformation changes the number of
+// steps), so one output must be a prefix of the other, unless both
+// finished.
+static
+bool same_output(const InterpResult &a, const InterpResult &b) {
+  int len = MIN(a.output.len(), b.output.len());
+  if (a.finished && b.finished && a.output.len() != b.output.len())
+    return false;
+  LOOP(i, 0, len) {
+    if (a.output[i] != b.output[i])
+      return false;
+  }
+  return true;
+}
+
+#endif
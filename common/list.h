@@ -39,7 +39,26 @@ struct ListNode {
     assert(parent == new_node_parent && "The two nodes have a different parent.");
     // Update the parent
     ListTy *sublist = parent->get_sublist();
-    sublist->inserted_after(this);
+    sublist->inserted_after(this, new_node);
+  }
+
+  // Anything that you insert should be heap-allocated!
+  // Insert `new_node` before the current one.
+  void insert_before(NodeTy *new_node) {
+    ParentTy *parent = get_node_parent();
+    assert(parent && "Node does not have a parent; it's unlinked.");
+
+    new_node->prev = this->prev;
+    new_node->next = this;
+    if (this->prev) {
+      this->prev->next = new_node;
+    }
+    this->prev = new_node;
+
+    ParentTy *new_node_parent = new_node->get_node_parent();
+    assert(parent == new_node_parent && "The two nodes have a different parent.");
+    ListTy *sublist = parent->get_sublist();
+    sublist->inserted_before(this, new_node);
   }
 
   // Unlink this node from the list.
@@ -92,9 +111,31 @@ struct ListWithParent {
     size++;
   }
 
-  void inserted_after(ListNodeTy *n) {
+  // Anything that you insert should be heap-allocated!
+  void insert_at_beginning(NodeTy *new_node) {
+    new_node->prev = nullptr;
+    if (!head) {
+      assert(!tail);
+      head = tail = new_node;
+      new_node->next = nullptr;
+    } else {
+      head->prev = new_node;
+      new_node->next = head;
+      head = new_node;
+    }
+    size++;
+  }
+
+  void inserted_after(ListNodeTy *n, ListNodeTy *new_node) {
     if (n == tail) {
-      tail = n;
+      tail = new_node;
+    }
+    size++;
+  }
+
+  void inserted_before(ListNodeTy *n, ListNodeTy *new_node) {
+    if (n == head) {
+      head = new_node;
     }
     size++;
   }
@@ -299,12 +299,16 @@ void expect_token(TOK kind) {
 
 static int curr_bb = 0;
 
+static int __max_reg_used;
+
 static
 Value parse_value(void) {
   Value v;
   switch (token.kind) {
   case TOK_REG: {
     v = val_reg(token.val);
+    // Registers may be used without being defined.
+    __max_reg_used = MAX(__max_reg_used, token.val);
   } break;
   case TOK_INTLIT: {
     v = val_imm(token.val);
@@ -338,10 +342,8 @@ Operation parse_operation(void) {
 static
 int starts_value(void) { return (is_token(TOK_REG) || is_token(TOK_INTLIT)); }
 
-static int __max_reg_used;
-
 static
-Instruction *parse_instruction(int bb_num, CFG cfg) {
+Instruction *parse_instruction(void) {
   Instruction *i;
   switch (token.kind) {
   case TOK_REG: {
@@ -363,7 +365,6 @@ Instruction *parse_instruction(int bb_num, CFG cfg) {
     next_token();
     int lbl = token.val;
     if (match_token(TOK_LBL)) {
-      cfg.add_edge(bb_num, lbl);
       i = Instruction::br_uncond(lbl);
     } else {
       assert(starts_value());
@@ -375,9 +376,6 @@ Instruction *parse_instruction(int bb_num, CFG cfg) {
       int lbl2 = token.val;
       expect_token(TOK_LBL);
       i = Instruction::br_cond(val, lbl1, lbl2);
-      // Add edges to the CFG
-      cfg.add_edge(bb_num, lbl1);
-      cfg.add_edge(bb_num, lbl2);
     }
   } break;
   default:
@@ -396,27 +394,64 @@ int starts_instruction(void) {
   return (is_token(TOK_REG) || is_token(TOK_PRINT) || is_token(TOK_BR));
 }
 
+// Parse the next block into `bb` (which is numbered by the caller). It
+// doesn't add the edges of its branches.
 static
-void parse_bb(CFG cfg) {
+void parse_bb_insts(BasicBlock *bb) {
   int bb_num = token.val;
   expect_token(TOK_LBL);
   if (bb_num != curr_bb) {
-    fatal_error("Expected basic block to be numbered: %d\n", loc.ln, curr_bb);
+    fatal_error("Expected basic block to be numbered: %d\n", curr_bb);
     return;
   }
+  assert(bb->num == bb_num);
   ++curr_bb;
   expect_token(TOK_COLON);
   expect_token(TOK_NL);
   while (starts_instruction()) {
-    cfg.bbs[bb_num].insert_inst_at_end(parse_instruction(bb_num, cfg));
+    bb->insert_inst_at_end(parse_instruction());
+  }
+}
+
+// The successors of every branch of `bb` in order (normally, there's one
+// branch at the end).
+template <typename AddEdge>
+static
+void for_each_branch_target(BasicBlock *bb, AddEdge add_edge) {
+  for (Instruction *inst : bb->insts) {
+    if (inst->kind == INST::BR_UNCOND) {
+      add_edge(inst->uncond_lbl);
+    } else if (inst->kind == INST::BR_COND) {
+      add_edge(inst->then);
+      add_edge(inst->els);
+    }
   }
 }
 
+static
+void parse_bb(CFG cfg) {
+  if (curr_bb >= cfg.size()) {
+    fatal_error("More basic blocks than expected");
+  }
+  BasicBlock *bb = &cfg.bbs[curr_bb];
+  parse_bb_insts(bb);
+  for_each_branch_target(bb, [&cfg, bb](int lbl) {
+    cfg.add_edge(bb->num, lbl);
+  });
+}
+
 static
 int count_bbs() {
   int res = 0;
   const char *runner = input;
   while (*runner) {
+    // Skip comments; they may contain colons.
+    if (*runner == ';') {
+      while (*runner != 0 && *runner != '\n') {
+        ++runner;
+      }
+      continue;
+    }
     if (*runner++ == ':')
       res++;
   }
@@ -455,6 +490,9 @@ static
 CFG parse_procedure(const char *filename, int *max_reg) {
   EntireFile file = read_entire_file(filename);
   lex_init(file.contents);
+  // So that we can parse more than one file.
+  curr_bb = 0;
+  __max_reg_used = 0;
 
   int nbbs = count_bbs();
   CFG cfg(nbbs);
@@ -477,4 +515,94 @@ CFG parse_procedure(const char *filename, int *max_reg) {
   return cfg;
 }
 
+/*
+Streaming: Parse the procedure in `in` (e.g. stdin) one block at a time,
+without reading all of it. The lines of a block are collected until the
+label of the next block (or the end of the input) and then the block is
+parsed and passed to `on_block(BasicBlock *)`. Its `succs` are set, but not
+its `preds` (we haven't seen the blocks that jump to it). After
+`on_block()` returns, the block is freed, so only one block is in memory.
+
+The labels of the blocks can't be checked against the number of blocks
+(we don't know it) and a trailing blank line is fine.
+*/
+
+// Parse the text of one block (or of what comes before the first one, if
+// `bb` is NULL), which starts at line `first_line` of the input.
+static
+void parse_stream_chunk(const char *text, int first_line, BasicBlock *bb) {
+  lex_init(text);
+  loc.ln = first_line;
+  while (is_token(TOK_NL))
+    next_token();
+  if (bb) {
+    parse_bb_insts(bb);
+  }
+  while (is_token(TOK_NL))
+    next_token();
+  if (!is_token(TOK_EOI)) {
+    fatal_error("Expected a basic block label");
+  }
+}
+
+template <typename OnBlock>
+static
+void parse_stream(FILE *in, OnBlock on_block, int *max_reg) {
+  curr_bb = 0;
+  __max_reg_used = 0;
+  Buf<char> text;
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  int ln = 1, first_line = 1;
+  bool in_block = false;
+  auto flush = [&]() {
+    text.push('\0');
+    if (!in_block) {
+      parse_stream_chunk(text.data, first_line, NULL);
+      text.clear();
+      return;
+    }
+    BasicBlock bb;
+    bb.num = curr_bb;
+    parse_stream_chunk(text.data, first_line, &bb);
+    text.clear();
+    for_each_branch_target(&bb, [&bb](int lbl) {
+      bb.succs.push(lbl);
+    });
+    on_block(&bb);
+    while (bb.insts.head) {
+      Instruction *inst = (Instruction *) bb.insts.head;
+      inst->unlink();
+      delete inst;
+    }
+    bb.succs.free();
+    bb.preds.free();
+  };
+  while ((len = getline(&line, &cap, in)) != -1) {
+    const char *p = line;
+    while (*p == ' ' || *p == '\t')
+      ++p;
+    // A label starts a new block.
+    if (*p == '.') {
+      flush();
+      in_block = true;
+      first_line = ln;
+    }
+    LOOP(i, 0, len) {
+      text.push(line[i]);
+    }
+    if (line[len - 1] != '\n') {
+      text.push('\n');
+    }
+    ++ln;
+  }
+  flush();
+  if (max_reg != NULL) {
+    *max_reg = __max_reg_used;
+  }
+  ::free(line);
+  text.free();
+}
+
 #endif
@@ -0,0 +1,148 @@
+#ifndef REG_COMPACTION_H
+#define REG_COMPACTION_H
+
+#include <stdlib.h>
+
+#include "buf.h"
+#include "cfg.h"
+#include "stefanos.h"
+
+/*
+Register compaction: Rename the registers of a CFG to a dense range [0, k),
+where k is the number of distinct registers used.
+
+Everything that is indexed by register (the liveness bitsets, the SSA
+stacks, ...) is sized by the max register, which is what the parser gives
+us. A single stray `%1000000` makes every LiveOut set ~122 KB, even if only
+20 registers are used. After compaction, the sets have k elements.
+
+The dense names keep the order of the original ones (the i-th smallest
+register used becomes `%i`), so anything that is printed in register order
+(e.g. a bitset) comes out in the same order with either set of names. The
+registers are renamed in place: DEF / PHI destinations and every register
+operand (including the condition of BR and the PHI arguments). `RegisterMap`
+keeps the original name of every dense register, for printing (pass
+`orig.data` as `reg_names` to the `print()` functions of cfg.h) or to
+undo the renaming with `restore_registers()`.
+
+It doesn't need any array indexed by the original names: the registers
+are collected and sorted, and the lookups are binary searches.
+*/
+
+// Call `f(reg)` on every register that `inst` defines or uses and
+// replace the register with its return value.
+template <typename F>
+static void inst_map_regs(Instruction *inst, F f) {
+  auto map_val = [&f](Value *v) {
+    if (val_kind(*v) == VAL_REG) {
+      *v = val_reg(f(val_strip_kind(*v)));
+    }
+  };
+  switch (inst->kind) {
+  case INST::DEF:
+    inst->reg = f(inst->reg);
+    // Fallthrough
+  case INST::PRINT:
+    map_val(&inst->op.lhs);
+    if (inst->op.kind == OP_ADD) {
+      map_val(&inst->op.rhs);
+    }
+    break;
+  case INST::PHI:
+    inst->reg = f(inst->reg);
+    for (Value &arg : inst->phi_args) {
+      map_val(&arg);
+    }
+    break;
+  case INST::BR_COND:
+    map_val(&inst->cond_val);
+    break;
+  case INST::BR_UNCOND:
+    break;
+  default:
+    assert(0);
+  }
+}
+
+template <typename F>
+static void cfg_map_regs(CFG cfg, F f) {
+  for (BasicBlock &bb : cfg.bbs) {
+    for (Instruction *inst : bb.insts) {
+      inst_map_regs(inst, f);
+    }
+  }
+}
+
+typedef struct RegisterMap {
+  // The original name of every dense register, in increasing order.
+  Buf<uint32_t> orig;
+
+  int num_registers() const {
+    return orig.len();
+  }
+
+  // -1 if no register is used.
+  int max_register() const {
+    return orig.len() - 1;
+  }
+
+  // The dense name of the original register `r` or -1 if it's not used.
+  int dense(uint32_t r) const {
+    int lo = 0, hi = orig.len();
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (orig[mid] < r) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return (lo < orig.len() && orig[lo] == r) ? lo : -1;
+  }
+
+  void free() {
+    orig.free();
+  }
+} RegisterMap;
+
+static
+int reg_compare(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *) a;
+  uint32_t y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+// Rename the registers of `cfg` to [0, k). The new max register
+// is `map.max_register()`.
+static
+RegisterMap compact_registers(CFG cfg) {
+  RegisterMap map;
+  cfg_map_regs(cfg, [&map](uint32_t r) {
+    map.orig.push(r);
+    return r;
+  });
+  if (map.orig.len()) {
+    qsort(map.orig.data, map.orig.len(), sizeof(uint32_t), reg_compare);
+    int k = 1;
+    LOOP(i, 1, map.orig.len()) {
+      if (map.orig[i] != map.orig[k - 1]) {
+        map.orig[k++] = map.orig[i];
+      }
+    }
+    map.orig.resize(k);
+  }
+  cfg_map_regs(cfg, [&map](uint32_t r) {
+    return (uint32_t) map.dense(r);
+  });
+  return map;
+}
+
+// Undo `compact_registers()`.
+static
+void restore_registers(CFG cfg, const RegisterMap map) {
+  cfg_map_regs(cfg, [&map](uint32_t r) {
+    return map.orig[r];
+  });
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef SCC_H
+#define SCC_H
+
+#include <iterator>
+#include <string.h>
+
+#include "buf.h"
+#include "cfg.h"
+#include "stefanos.h"
+
+/*
+Strongly Connected Components with Pearce's variant of Tarjan's algorithm
+("A Space-Efficient Algorithm for Finding Strongly Connected Components").
+It's iterative (explicit stack of frames) and, instead of `index`, `lowlink`
+and `on_stack`, it only keeps one number per node (`rindex`).
+
+Tarjan completes a component only after all the components it reaches,
+so the components are numbered in reverse topological order: for every
+edge u -> v, comp(u) >= comp(v). I.e., 0 is a sink and the last one
+is a source. So:
+- A backward dataflow problem (e.g. liveness) visits them in increasing order.
+- A forward dataflow problem (e.g. dominators) visits them in decreasing order.
+
+`scc_compute()` works on any graph: `edges(v)` must return a reference to
+a range of ints (e.g. a `const Buf<int> &`). `cfg_sccs()` is the version
+for the CFG (over the succs). All the nodes are in a component, even the
+ones not reachable from the entry.
+*/
+
+typedef struct SCCs {
+  // Component of every node
+  Buf<int> comp;
+  // CSR: The nodes of component `c` are `nodes[offsets[c] .. offsets[c+1])`,
+  // in increasing order (but see `order_members_by()`).
+  Buf<int> offsets;
+  Buf<int> nodes;
+  // A component is cyclic if it has more than one node or a self-loop.
+  Buf<bool> cyclic;
+  // CSR: The condensation DAG, i.e. the successor components of
+  // every component (without duplicates).
+  Buf<int> dag_offsets;
+  Buf<int> dag_succs;
+
+  int size() const {
+    return cyclic.len();
+  }
+
+  int num_members(int c) const {
+    return offsets[c + 1] - offsets[c];
+  }
+
+  const int *members_begin(int c) const {
+    return &nodes.data[offsets[c]];
+  }
+
+  const int *members_end(int c) const {
+    return &nodes.data[offsets[c + 1]];
+  }
+
+  const int *dag_succs_begin(int c) const {
+    return &dag_succs.data[dag_offsets[c]];
+  }
+
+  const int *dag_succs_end(int c) const {
+    return &dag_succs.data[dag_offsets[c + 1]];
+  }
+
+  bool is_cyclic(int c) const {
+    return cyclic[c];
+  }
+
+  // Reorder the members of every component so that they follow `order`
+  // (e.g. the postorder). Nodes that are not in `order` go last.
+  void order_members_by(const Buf<int> order) {
+    int n = comp.len();
+    Buf<int> cursor;
+    cursor.reserve_and_set(size());
+    memcpy(cursor.data, offsets.data, size() * sizeof(int));
+    Buf<bool> placed;
+    placed.reserve_and_set(n);
+    memset(placed.data, 0, n * sizeof(bool));
+    for (int v : order) {
+      nodes[cursor[comp[v]]++] = v;
+      placed[v] = true;
+    }
+    LOOP(v, 0, n) {
+      if (!placed[v]) {
+        nodes[cursor[comp[v]]++] = v;
+      }
+    }
+    placed.free();
+    cursor.free();
+  }
+
+  void free() {
+    comp.free();
+    offsets.free();
+    nodes.free();
+    cyclic.free();
+    dag_offsets.free();
+    dag_succs.free();
+  }
+} SCCs;
+
+template <typename EdgesFn>
+SCCs scc_compute(int n, EdgesFn edges) {
+  typedef decltype(std::begin(edges(0))) EdgeIt;
+  struct Frame {
+    int v;
+    EdgeIt it, end;
+    bool root;
+  };
+
+  // 0: not visited yet. While a node is active (i.e. in `frames` or
+  // in `stack`), it's its DFS index, or lower if it reaches an
+  // earlier active node. Once its component is complete, it's the
+  // number of the component counting down from n - 1. These are
+  // always larger than the indices of the active nodes.
+  Buf<int> rindex;
+  rindex.reserve_and_set(n);
+  memset(rindex.data, 0, n * sizeof(int));
+  Buf<Frame> frames;
+  // Nodes whose component is not complete yet.
+  Buf<int> stack;
+  int index = 1;
+  int c = n - 1;
+
+  LOOP(r, 0, n) {
+    if (rindex[r])
+      continue;
+    rindex[r] = index++;
+    frames.push(Frame{r, std::begin(edges(r)), std::end(edges(r)), true});
+    while (frames.len()) {
+      Frame &f = frames[frames.len() - 1];
+      if (f.it != f.end) {
+        int w = *f.it;
+        if (!rindex[w]) {
+          // Don't advance `f.it`; when we return to `f`, we'll
+          // see `w` again and take its `rindex` into account.
+          rindex[w] = index++;
+          frames.push(Frame{w, std::begin(edges(w)), std::end(edges(w)), true});
+          continue;
+        }
+        if (rindex[w] < rindex[f.v]) {
+          rindex[f.v] = rindex[w];
+          f.root = false;
+        }
+        ++f.it;
+        continue;
+      }
+
+      int v = f.v;
+      bool root = f.root;
+      frames.pop_back();
+      if (!root) {
+        stack.push(v);
+        continue;
+      }
+      // `v` is the root of a component, which consists of `v` and the
+      // nodes above it in `stack` that were visited after it.
+      --index;
+      while (stack.len() && rindex[v] <= rindex[stack.back()]) {
+        rindex[stack.back()] = c;
+        stack.pop_back();
+        --index;
+      }
+      rindex[v] = c;
+      --c;
+    }
+  }
+  frames.free();
+  stack.free();
+
+  SCCs sccs;
+  int num_sccs = n - 1 - c;
+  sccs.comp.reserve_and_set(n);
+  LOOP(v, 0, n) {
+    sccs.comp[v] = (n - 1) - rindex[v];
+  }
+  rindex.free();
+
+  // Members, with a counting sort.
+  sccs.offsets.reserve_and_set(num_sccs + 1);
+  memset(sccs.offsets.data, 0, (num_sccs + 1) * sizeof(int));
+  LOOP(v, 0, n) {
+    sccs.offsets[sccs.comp[v] + 1]++;
+  }
+  LOOP(k, 0, num_sccs) {
+    sccs.offsets[k + 1] += sccs.offsets[k];
+  }
+  sccs.nodes.reserve_and_set(n);
+  Buf<int> cursor;
+  cursor.reserve_and_set(num_sccs);
+  memcpy(cursor.data, sccs.offsets.data, num_sccs * sizeof(int));
+  LOOP(v, 0, n) {
+    sccs.nodes[cursor[sccs.comp[v]]++] = v;
+  }
+  cursor.free();
+
+  // Cyclic flags and the condensation DAG. `mark` is the last
+  // component that added each component as a successor.
+  sccs.cyclic.reserve_and_set(num_sccs);
+  sccs.dag_offsets.reserve_and_set(num_sccs + 1);
+  Buf<int> mark;
+  mark.reserve_and_set(num_sccs);
+  LOOP(k, 0, num_sccs) {
+    mark[k] = -1;
+  }
+  sccs.dag_offsets[0] = 0;
+  LOOP(k, 0, num_sccs) {
+    bool cyclic = sccs.num_members(k) > 1;
+    for (const int *v = sccs.members_begin(k); v != sccs.members_end(k); ++v) {
+      for (int w : edges(*v)) {
+        int cw = sccs.comp[w];
+        if (cw == k) {
+          cyclic = true;
+        } else if (mark[cw] != k) {
+          mark[cw] = k;
+          sccs.dag_succs.push(cw);
+        }
+      }
+    }
+    sccs.cyclic[k] = cyclic;
+    sccs.dag_offsets[k + 1] = sccs.dag_succs.len();
+  }
+  mark.free();
+  return sccs;
+}
+
+static
+SCCs cfg_sccs(const CFG cfg) {
+  return scc_compute(cfg.size(), [&cfg](int v) -> const Buf<int> & {
+    return cfg.bbs[v].succs;
+  });
+}
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include "buf.h"
+#include "cfg.h"
+#include "stefanos.h"
+
+/*
+Iterative traversals of a CFG: preorder, postorder, reverse postorder (RPO)
+and BFS, either forwards (over the succs) or backwards (over the preds).
+
+They use an explicit stack, so there's no limit on the size of the CFG
+(a recursive DFS overflows the stack at ~100k blocks of a linear CFG).
+The DFS visits the successors in the order they appear in `succs` (or
+`preds`) and marks a block visited when it's discovered, which gives
+exactly the postorder of the obvious recursive DFS.
+
+A `Traversal` keeps its buffers (the stack and the visited marks) around,
+so that running many traversals costs no allocations after the first.
+The visited marks are generation stamps, so they're not cleared either.
+The results are put in a caller-provided Buf, which is cleared first.
+Only the blocks reachable from the root are in the result.
+
+The forward postorder and RPO from the entry, which is what most analyses
+need, are also cached on the CFG (see `cfg_postorder()`).
+*/
+
+enum class DIR {
+  FORWARD,   // over succs
+  BACKWARD,  // over preds
+};
+
+struct Traversal {
+  Traversal() {
+    generation = 0;
+  }
+
+  void preorder(const CFG cfg, int root, DIR dir, Buf<int> *out) {
+    dfs(cfg, root, dir, out, NULL);
+  }
+
+  void postorder(const CFG cfg, int root, DIR dir, Buf<int> *out) {
+    dfs(cfg, root, dir, NULL, out);
+  }
+
+  void rpo(const CFG cfg, int root, DIR dir, Buf<int> *out) {
+    dfs(cfg, root, dir, NULL, out);
+    reverse(*out);
+  }
+
+  // Both orders with a single DFS. Either can be NULL.
+  void dfs(const CFG cfg, int root, DIR dir, Buf<int> *pre, Buf<int> *post) {
+    start(cfg);
+    if (pre)
+      pre->clear();
+    if (post)
+      post->clear();
+
+    visit(root, pre);
+    stack.push(Frame{root, 0});
+    while (stack.len()) {
+      Frame &f = stack[stack.len() - 1];
+      const Buf<int> &next = edges(cfg, f.bb, dir);
+      if (f.next_edge < next.len()) {
+        int n = next[f.next_edge++];
+        if (visited[n] != generation) {
+          visit(n, pre);
+          // `f` is invalidated by the push.
+          stack.push(Frame{n, 0});
+        }
+        continue;
+      }
+      if (post)
+        post->push(f.bb);
+      stack.pop_back();
+    }
+  }
+
+  // Breadth-first order. `out` is also used as the queue.
+  void bfs(const CFG cfg, int root, DIR dir, Buf<int> *out) {
+    start(cfg);
+    out->clear();
+    visit(root, out);
+    for (int i = 0; i < out->len(); ++i) {
+      int bb = (*out)[i];
+      for (int n : edges(cfg, bb, dir)) {
+        if (visited[n] != generation) {
+          visit(n, out);
+        }
+      }
+    }
+  }
+
+  // Return true if `bb` was reached by the last traversal.
+  bool was_visited(int bb) const {
+    return visited[bb] == generation;
+  }
+
+  void free() {
+    visited.free();
+    stack.free();
+  }
+
+private:
+
+  struct Frame {
+    int bb;
+    int next_edge;
+  };
+
+  static
+  const Buf<int> &edges(const CFG &cfg, int bb, DIR dir) {
+    return (dir == DIR::FORWARD) ? cfg.bbs[bb].succs : cfg.bbs[bb].preds;
+  }
+
+  static
+  void reverse(Buf<int> v) {
+    LOOP(i, 0, v.len() / 2) {
+      int tmp = v[i];
+      v[i] = v[v.len() - 1 - i];
+      v[v.len() - 1 - i] = tmp;
+    }
+  }
+
+  void start(const CFG cfg) {
+    ++generation;
+    if (visited.len() < cfg.size()) {
+      int old_len = visited.len();
+      visited.resize(cfg.size());
+      LOOP(i, old_len, visited.len()) {
+        visited[i] = 0;
+      }
+    }
+    stack.clear();
+  }
+
+  void visit(int bb, Buf<int> *pre) {
+    visited[bb] = generation;
+    if (pre)
+      pre->push(bb);
+  }
+
+  /// Members ///
+
+  Buf<int> visited;
+  int generation;
+  Buf<Frame> stack;
+};
+
+// Fill the cache of `cfg` if it's stale.
+static
+void cfg_compute_orders(const CFG cfg) {
+  TraversalCache *cache = cfg.trav_cache;
+  if (cache->valid)
+    return;
+  Traversal t;
+  t.postorder(cfg, 0, DIR::FORWARD, &cache->postorder);
+  t.free();
+  int nbbs = cfg.size();
+  int len = cache->postorder.len();
+  cache->rpo.resize(len);
+  cache->post_num.resize(nbbs);
+  LOOP(bb, 0, nbbs) {
+    cache->post_num[bb] = -1;
+  }
+  LOOP(i, 0, len) {
+    int bb = cache->postorder[i];
+    cache->rpo[len - 1 - i] = bb;
+    cache->post_num[bb] = i;
+  }
+  cache->valid = true;
+}
+
+// The forward postorder from the entry. It's owned by the CFG (don't free it)
+// and it's valid until the CFG changes.
+static
+const Buf<int> cfg_postorder(const CFG cfg) {
+  cfg_compute_orders(cfg);
+  return cfg.trav_cache->postorder;
+}
+
+// The reverse of `cfg_postorder()`. Same rules.
+static
+const Buf<int> cfg_rpo(const CFG cfg) {
+  cfg_compute_orders(cfg);
+  return cfg.trav_cache->rpo;
+}
+
+// The position of every block in `cfg_postorder()` or -1 if it's unreachable.
+// Same rules.
+static
+const Buf<int> cfg_postorder_numbers(const CFG cfg) {
+  cfg_compute_orders(cfg);
+  return cfg.trav_cache->post_num;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+
+#include "sccp.h"
+
+// Usage: apply_sccp file
+// Propagates the constants (see sccp.h), folds the branches on constants
+// and prints the result (the registers are renamed; see SSA) and what
+// changed.
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  int max_reg;
+  CFG cfg = parse_procedure(argv[1], &max_reg);
+  SCCP sccp;
+  sccp.apply(cfg, max_reg);
+  cfg.print();
+  printf("Constants: %d definitions, %d uses; %d branches folded, "
+         "%d blocks unreachable\n", sccp.constants, sccp.propagated,
+         sccp.branches_folded, sccp.unreachable);
+  sccp.free();
+  cfg.destruct();
+}
@@ -0,0 +1,94 @@
+#include <stdlib.h>
+
+#include "../common/analyses_time.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/interpreter.h"
+#include "../common/stefanos.h"
+
+#include "sccp.h"
+
+/* Benchmark utilities */
+
+// Like generated (e.g. templated) code: Half of the branches test a
+// constant, which is either an immediate or a register that was set to one
+// in the entry. The constant always takes the successor with the larger
+// number, so that the rest of the procedure is still reachable.
+static
+CFG generate(CFG (*gen)(int), int nelems, int nregs, int ninsts) {
+ CFG cfg = gen(nelems);
+ srand(nelems);
+ populate_cfg(cfg, nregs, ninsts);
+ // The flags: %nregs is 0 and %(nregs + 1) is 1.
+ LOOP(r, 0, 2) {
+   Instruction *flag = Instruction::def(nregs + r, op_simple(val_imm(r)));
+   cfg.bbs[0].insert_inst_at_beginning(flag);
+ }
+ for (BasicBlock &bb : cfg.bbs) {
+   Instruction *term = bb.terminator();
+   if (!term || term->kind != INST::BR_COND || rand() % 2)
+     continue;
+   int c = term->then > term->els;
+   term->cond_val = (rand() % 2) ? val_imm(c) : val_reg(nregs + c);
+ }
+ return cfg;
+}
+
+// SCCP (which includes the SSA construction and destruction) and then the
+// time of the analyses that only look at the reachable blocks, before and
+// after it. The output must stay the same. "Before" is the code after going
+// to SSA and back without SCCP, so that it has the same registers. Out of
+// SSA leaves a register for every SSA name (there's no coalescing), so
+// liveness keeps the sizes small.
+static
+void sccp_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 2000, 4000, 8000 };
+ int nregs = 16, ninsts = 8;
+ int64_t max_steps = 1000000;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG orig = generate(gen, set[i], nregs, ninsts);
+   CFG ssa_cfg = generate(gen, set[i], nregs, ninsts);
+   CFG cfg = generate(gen, set[i], nregs, ninsts);
+   int max_reg = nregs + 1;
+   SSAInfo info = ssa_construct(ssa_cfg, max_reg, SSA_KIND::PRUNED);
+   ssa_destruct(ssa_cfg);
+
+   double time_taken;
+   SCCP sccp;
+   TIME_STMT(sccp.apply(cfg, max_reg), time_taken);
+
+   // Out of SSA adds copies, so it needs more steps.
+   InterpResult before = interpret(orig, max_reg, max_steps);
+   InterpResult after = interpret(cfg, sccp.max_register, 2 * max_steps);
+   assert(same_output(before, after));
+   before.free();
+   after.free();
+
+   double dtree_before, live_before, dtree_after, live_after;
+   analyses_time(ssa_cfg, info.max_reg, &dtree_before, &live_before);
+   analyses_time(cfg, sccp.max_register, &dtree_after, &live_after);
+   int nreachable = cfg_rpo(orig).len();
+   printf("Benchmark SCCP: %d elements: %.4lfs (%d definitions and %d uses "
+          "became constants, %d branches folded, %d of %d blocks "
+          "unreachable)\n", set[i], time_taken, sccp.constants,
+          sccp.propagated, sccp.branches_folded, sccp.unreachable,
+          nreachable);
+   printf("  Dominator tree: %.4lfs -> %.4lfs, liveness: %.4lfs -> %.4lfs\n",
+          dtree_before, dtree_after, live_before, live_after);
+   sccp.free();
+   info.free();
+   cfg.destruct();
+   ssa_cfg.destruct();
+   orig.destruct();
+ }
+ printf("\n");
+}
+
+int main() {
+  sccp_benchmark("FwdBack", fwdback_cfg);
+  sccp_benchmark("DeepLoops", deep_loops_cfg);
+  sccp_benchmark("Irreducible", irreducible_cfg);
+
+  return 0;
+}
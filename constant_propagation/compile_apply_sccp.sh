@@ -0,0 +1,2 @@
+g++ apply_sccp.cpp -o apply_sccp
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
@@ -0,0 +1,441 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+#include "../common/traversal.h"
+#include "../ssa/ssa.h"
+
+/*
+Sparse Conditional Constant Propagation (Wegman & Zadeck, "Constant
+Propagation with Conditional Branches"; also Engineering a Compiler,
+Section 10.7.1).
+
+Every SSA register has a value in the lattice TOP (not known yet) >
+CONST c > BOTTOM (not a constant). Everything starts at TOP and only goes
+down, and only the code that can execute is evaluated:
+
+1) The code is converted to (pruned) SSA (see /ssa/ssa.h), so that a
+   register has one value everywhere.
+2) Two worklists:
+   - The CFG worklist has the edges that became executable. When a block is
+     reached for the first time, all of its instructions are evaluated.
+     Otherwise, only its phis (they have a new argument).
+   - The SSA worklist has the registers whose value went down. The
+     instructions that use them (the def-use chains) are evaluated again,
+     if their block is executable.
+   A phi is the meet of its arguments on the executable edges only. A
+   branch marks only the edges it can take: none if its condition is TOP,
+   one if it's a constant and both if it's BOTTOM.
+3) Rewrite: A definition of a constant becomes the constant and the uses of
+   constant registers become immediates. A BR_COND with a constant
+   condition becomes a BR_UNCOND and the other edge is removed from `succs`
+   and `preds` (and its argument from the phis). The blocks that were never
+   executed are now unreachable, so e.g. the dominator tree and liveness
+   don't see them anymore (they're still in the CFG).
+4) Out of SSA.
+
+Like the interpreter, an addition wraps around (see `imm_add()`).
+Registers without a definition are the inputs of the procedure and they're
+BOTTOM (as are the phis of the entry).
+*/
+
+enum class LATTICE {
+  TOP,
+  CONST,
+  BOTTOM,
+};
+
+typedef struct LatticeVal {
+  LATTICE kind;
+  // Only for CONST
+  uint32_t c;
+
+  bool operator==(LatticeVal other) const {
+    return kind == other.kind && (kind != LATTICE::CONST || c == other.c);
+  }
+  bool operator!=(LatticeVal other) const {
+    return !(*this == other);
+  }
+} LatticeVal;
+
+static
+LatticeVal lattice_top(void) {
+  return LatticeVal{LATTICE::TOP, 0};
+}
+
+static
+LatticeVal lattice_const(uint32_t c) {
+  return LatticeVal{LATTICE::CONST, c};
+}
+
+static
+LatticeVal lattice_bottom(void) {
+  return LatticeVal{LATTICE::BOTTOM, 0};
+}
+
+static
+LatticeVal lattice_meet(LatticeVal a, LatticeVal b) {
+  if (a.kind == LATTICE::TOP)
+    return b;
+  if (b.kind == LATTICE::TOP)
+    return a;
+  if (a == b)
+    return a;
+  return lattice_bottom();
+}
+
+static
+LatticeVal lattice_add(LatticeVal a, LatticeVal b) {
+  if (a.kind == LATTICE::BOTTOM || b.kind == LATTICE::BOTTOM)
+    return lattice_bottom();
+  if (a.kind == LATTICE::TOP || b.kind == LATTICE::TOP)
+    return lattice_top();
+  return lattice_const(imm_add(a.c, b.c));
+}
+
+// Remove (one of) the edges `pred` -> `bb` from the predecessors of `bb`,
+// along with the respective arguments of its phis.
+static
+void sccp_remove_pred(BasicBlock *bb, int pred) {
+  int j = 0;
+  while (bb->preds[j] != pred) {
+    ++j;
+  }
+  int last = bb->preds.len() - 1;
+  LOOP(k, j, last) {
+    bb->preds[k] = bb->preds[k + 1];
+  }
+  bb->preds.pop_back();
+  for (Instruction *inst : bb->insts) {
+    if (inst->kind != INST::PHI)
+      break;
+    LOOP(k, j, last) {
+      inst->phi_args[k] = inst->phi_args[k + 1];
+    }
+    inst->phi_args.pop_back();
+  }
+}
+
+struct SCCP {
+  SCCP() {
+    max_register = -1;
+    constants = propagated = branches_folded = unreachable = 0;
+  }
+
+  // Apply it to `cfg`, whose max register is `max_reg`. The registers are
+  // renamed (see SSA) and `max_register` is the max register after it.
+  void apply(CFG cfg, int max_reg) {
+    max_register = max_reg;
+    if (!cfg.size())
+      return;
+    const Buf<int> post_num = cfg_postorder_numbers(cfg);
+    int nreachable = 0;
+    for (int n : post_num) {
+      nreachable += n != -1;
+    }
+    SSAInfo info = ssa_construct(cfg, max_reg, SSA_KIND::PRUNED);
+    max_register = info.max_reg;
+    info.free();
+    init(cfg);
+    propagate(cfg);
+    rewrite(cfg);
+    fold_branches(cfg);
+    LOOP(b, 0, cfg.size()) {
+      nreachable -= executable[b];
+    }
+    unreachable = nreachable;
+    ssa_destruct(cfg);
+  }
+
+  void free() {
+    lat.free();
+    for (Buf<Instruction *> &u : uses) {
+      u.free();
+    }
+    uses.free();
+    succ_offset.free();
+    edge_from.free();
+    edge_exec.free();
+    executable.free();
+    cfg_worklist.free();
+    ssa_worklist.free();
+  }
+
+  int max_register;
+  // Definitions that became a constant, register operands replaced with a
+  // constant, BR_CONDs that became BR_UNCONDs and blocks that were reachable
+  // and are not anymore.
+  int constants, propagated, branches_folded, unreachable;
+
+private:
+  LatticeVal value_of(Value v) const {
+    if (val_kind(v) == VAL_IMM)
+      return lattice_const(val_strip_kind(v));
+    return lat[val_strip_kind(v)];
+  }
+
+  LatticeVal eval_op(Operation op) const {
+    LatticeVal lhs = value_of(op.lhs);
+    if (op.kind == OP_SIMPLE)
+      return lhs;
+    return lattice_add(lhs, value_of(op.rhs));
+  }
+
+  // The lattice of every register, the def-use chains and the edges.
+  void init(CFG cfg) {
+    int nregs = max_register + 1;
+    int nbbs = cfg.size();
+    lat.reserve_and_set(nregs);
+    LOOP(r, 0, nregs) {
+      // Registers without a definition are the inputs of the procedure.
+      lat[r] = lattice_bottom();
+    }
+    uses.reserve_and_set(nregs);
+    uses.initialize();
+    auto add_use = [this](Value v, Instruction *inst) {
+      if (val_kind(v) == VAL_REG) {
+        uses[val_strip_kind(v)].push(inst);
+      }
+    };
+    for (int b : cfg_rpo(cfg)) {
+      for (Instruction *inst : cfg.bbs[b].insts) {
+        switch (inst->kind) {
+        case INST::PHI:
+          for (Value arg : inst->phi_args) {
+            add_use(arg, inst);
+          }
+          lat[inst->reg] = lattice_top();
+          break;
+        case INST::DEF:
+          add_use(inst->op.lhs, inst);
+          if (inst->op.kind == OP_ADD) {
+            add_use(inst->op.rhs, inst);
+          }
+          lat[inst->reg] = lattice_top();
+          break;
+        case INST::PRINT:
+        case INST::BR_UNCOND:
+          break;
+        case INST::BR_COND:
+          add_use(inst->cond_val, inst);
+          break;
+        default:
+          assert(0);
+        }
+      }
+    }
+    // The edges of `b` are [succ_offset[b], succ_offset[b + 1]), in the
+    // order of `succs`.
+    succ_offset.reserve_and_set(nbbs + 1);
+    succ_offset[0] = 0;
+    LOOP(b, 0, nbbs) {
+      succ_offset[b + 1] = succ_offset[b] + cfg.bbs[b].succs.len();
+    }
+    edge_from.reserve_and_set(succ_offset[nbbs]);
+    LOOP(b, 0, nbbs) {
+      LOOP(e, succ_offset[b], succ_offset[b + 1]) {
+        edge_from[e] = b;
+      }
+    }
+    edge_exec.reserve_and_set(succ_offset[nbbs]);
+    memset(edge_exec.data, 0, succ_offset[nbbs] * sizeof(bool));
+    executable.reserve_and_set(nbbs);
+    memset(executable.data, 0, nbbs * sizeof(bool));
+  }
+
+  // Is an edge `pred` -> `b` executable?
+  bool is_edge_executable(CFG cfg, int pred, int b) const {
+    const Buf<int> &succs = cfg.bbs[pred].succs;
+    LOOP(i, 0, succs.len()) {
+      if (succs[i] == b && edge_exec[succ_offset[pred] + i])
+        return true;
+    }
+    return false;
+  }
+
+  void mark_edge(int b, int i) {
+    int e = succ_offset[b] + i;
+    if (edge_exec[e])
+      return;
+    edge_exec[e] = true;
+    cfg_worklist.push(e);
+  }
+
+  void lower(int r, LatticeVal v) {
+    if (v == lat[r])
+      return;
+    lat[r] = v;
+    ssa_worklist.push(r);
+  }
+
+  void visit(CFG cfg, Instruction *inst) {
+    BasicBlock *bb = inst->get_parent();
+    switch (inst->kind) {
+    case INST::PHI: {
+      // The phis of the entry have values from outside the procedure too.
+      if (bb->num == 0) {
+        lower(inst->reg, lattice_bottom());
+        break;
+      }
+      LatticeVal v = lattice_top();
+      LOOP(j, 0, bb->preds.len()) {
+        if (is_edge_executable(cfg, bb->preds[j], bb->num)) {
+          v = lattice_meet(v, value_of(inst->phi_args[j]));
+        }
+      }
+      lower(inst->reg, v);
+    } break;
+    case INST::DEF:
+      lower(inst->reg, eval_op(inst->op));
+      break;
+    case INST::PRINT:
+      break;
+    case INST::BR_UNCOND:
+      mark_edge(bb->num, 0);
+      break;
+    case INST::BR_COND: {
+      assert(bb->succs[0] == inst->then && bb->succs[1] == inst->els);
+      LatticeVal c = value_of(inst->cond_val);
+      if (c.kind == LATTICE::TOP)
+        break;
+      if (c.kind == LATTICE::BOTTOM || c.c) {
+        mark_edge(bb->num, 0);
+      }
+      if (c.kind == LATTICE::BOTTOM || !c.c) {
+        mark_edge(bb->num, 1);
+      }
+    } break;
+    default:
+      assert(0);
+    }
+  }
+
+  void propagate(CFG cfg) {
+    // The edge into the entry.
+    executable[0] = true;
+    for (Instruction *inst : cfg.bbs[0].insts) {
+      visit(cfg, inst);
+    }
+    int cfg_head = 0;
+    while (cfg_head != cfg_worklist.len() || ssa_worklist.len()) {
+      while (cfg_head != cfg_worklist.len()) {
+        int e = cfg_worklist[cfg_head++];
+        int from = edge_from[e];
+        BasicBlock *succ = &cfg.bbs[cfg.bbs[from].succs[e - succ_offset[from]]];
+        bool first = !executable[succ->num];
+        executable[succ->num] = true;
+        for (Instruction *inst : succ->insts) {
+          if (!first && inst->kind != INST::PHI)
+            break;
+          visit(cfg, inst);
+        }
+      }
+      while (ssa_worklist.len()) {
+        int r = ssa_worklist.back();
+        ssa_worklist.pop_back();
+        for (Instruction *inst : uses[r]) {
+          if (executable[inst->get_parent()->num]) {
+            visit(cfg, inst);
+          }
+        }
+      }
+    }
+  }
+
+  void replace_use(Value *v) {
+    if (val_kind(*v) != VAL_REG)
+      return;
+    LatticeVal l = lat[val_strip_kind(*v)];
+    if (l.kind == LATTICE::CONST) {
+      *v = val_imm(l.c);
+      ++propagated;
+    }
+  }
+
+  void rewrite(CFG cfg) {
+    for (BasicBlock &bb : cfg.bbs) {
+      if (!executable[bb.num])
+        continue;
+      for (Instruction *inst : bb.insts) {
+        switch (inst->kind) {
+        case INST::PHI:
+          LOOP(j, 0, bb.preds.len()) {
+            if (is_edge_executable(cfg, bb.preds[j], bb.num)) {
+              replace_use(&inst->phi_args[j]);
+            }
+          }
+          break;
+        case INST::DEF: {
+          LatticeVal v = lat[inst->reg];
+          if (v.kind == LATTICE::CONST) {
+            Operation op = op_simple(val_imm(v.c));
+            if (inst->op.kind != op.kind || inst->op.lhs != op.lhs) {
+              inst->op = op;
+              ++constants;
+            }
+            break;
+          }
+          replace_use(&inst->op.lhs);
+          if (inst->op.kind == OP_ADD) {
+            replace_use(&inst->op.rhs);
+          }
+        } break;
+        case INST::PRINT:
+          replace_use(&inst->op.lhs);
+          break;
+        case INST::BR_UNCOND:
+        case INST::BR_COND:
+          break;
+        default:
+          assert(0);
+        }
+      }
+    }
+  }
+
+  // After `rewrite()`, since the edges are not executable anymore when
+  // they're removed.
+  void fold_branches(CFG cfg) {
+    for (BasicBlock &bb : cfg.bbs) {
+      Instruction *inst = bb.terminator();
+      if (!executable[bb.num] || !inst || inst->kind != INST::BR_COND)
+        continue;
+      LatticeVal c = value_of(inst->cond_val);
+      if (c.kind != LATTICE::CONST)
+        continue;
+      int taken = c.c ? inst->then : inst->els;
+      int other = c.c ? inst->els : inst->then;
+      Instruction *jump = Instruction::br_uncond(taken);
+      jump->set_parent(&bb);
+      inst->insert_before(jump);
+      inst->unlink();
+      delete inst;
+      sccp_remove_pred(&cfg.bbs[other], bb.num);
+      bb.succs.clear();
+      bb.succs.push(taken);
+      ++branches_folded;
+    }
+    if (branches_folded) {
+      cfg.invalidate_traversals();
+    }
+  }
+
+  /// Members ///
+
+  // The value of every register.
+  Buf<LatticeVal> lat;
+  // The instructions that use every register (in reachable blocks).
+  Buf<Buf<Instruction *>> uses;
+  Buf<int> succ_offset;
+  // The source of every edge.
+  Buf<int> edge_from;
+  Buf<bool> edge_exec;
+  Buf<bool> executable;
+  // Edges (indices into `edge_exec`); a FIFO.
+  Buf<int> cfg_worklist;
+  Buf<int> ssa_worklist;
+};
+
+#endif
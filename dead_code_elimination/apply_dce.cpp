@@ -0,0 +1,29 @@
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+
+#include "dce.h"
+
+// Usage: apply_dce [-aggressive] file
+// Removes the dead definitions (see dce.h) and prints the result and how
+// many instructions were removed. With -aggressive, branches that don't
+// matter become jumps too.
+int main(int argc, char **argv) {
+  assert(argc == 2 || argc == 3);
+  bool aggressive = false;
+  if (argc == 3) {
+    aggressive = !strcmp(argv[1], "-aggressive");
+    assert(aggressive);
+  }
+  int max_reg;
+  CFG cfg = parse_procedure(argv[argc - 1], &max_reg);
+  DCEStats stats = aggressive ? adce(cfg, max_reg) : dce(cfg, max_reg);
+  cfg.print();
+  printf("Removed: %d instructions", stats.removed);
+  if (aggressive) {
+    printf(", %d branches became jumps", stats.branches_folded);
+  }
+  printf("\n");
+  cfg.destruct();
+}
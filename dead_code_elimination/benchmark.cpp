@@ -0,0 +1,155 @@
+#include <glob.h>
+#include <stdlib.h>
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/interpreter.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+#include "../local_value_numbering/lvn.h"
+
+#include "dce.h"
+
+/* Benchmark utilities */
+
+// Like `populate_cfg()`, but only one in `print_every` instructions is a
+// PRINT, so that most of the definitions are dead.
+static
+void populate_cfg_few_prints(CFG cfg, int nregs, int ninsts, int print_every) {
+ for (BasicBlock &bb : cfg.bbs) {
+   LOOP(i, 0, ninsts) {
+     Value lhs = (rand() % 4) ? val_reg(rand() % nregs) : val_imm(rand() % 100);
+     if (!(rand() % print_every)) {
+       bb.insert_inst_at_end(Instruction::print(op_simple(lhs)));
+       continue;
+     }
+     Operation op = op_simple(lhs);
+     if (rand() % 2) {
+       op = op_add(lhs, val_reg(rand() % nregs));
+     }
+     bb.insert_inst_at_end(Instruction::def(rand() % nregs, op));
+   }
+   switch (bb.succs.len()) {
+   case 0:
+     break;
+   case 1:
+     bb.insert_inst_at_end(Instruction::br_uncond(bb.succs[0]));
+     break;
+   case 2:
+     bb.insert_inst_at_end(Instruction::br_cond(val_reg(rand() % nregs),
+                                                bb.succs[0], bb.succs[1]));
+     break;
+   default:
+     assert(0);
+   }
+ }
+}
+
+static
+int count_insts(CFG cfg) {
+ int res = 0;
+ for (BasicBlock &bb : cfg.bbs) {
+   res += bb.insts.size;
+ }
+ return res;
+}
+
+static
+CFG generate(CFG (*gen)(int), int nelems, int nregs, int ninsts, bool lvn) {
+ CFG cfg = gen(nelems);
+ srand(nelems);
+ populate_cfg_few_prints(cfg, nregs, ninsts, 8);
+ if (lvn) {
+   LVN lvn;
+   lvn.apply_all(cfg);
+   lvn.free();
+ }
+ return cfg;
+}
+
+// DCE against ADCE (which includes the control dependence graph), on the
+// generated code and on the code after LVN (which leaves copies that are
+// often dead). The output must stay the same. Only the first `nsizes`
+// sizes are used.
+static
+void dce_benchmark(const char *name, CFG (*gen)(int), int nsizes) {
+ int set[] = { 1000, 16000, 64000 };
+ assert(nsizes <= (int) ARR_LEN(set));
+ int nregs = 16, ninsts = 8;
+ int64_t max_steps = 1000000;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, nsizes) {
+   LOOP(lvn, 0, 2) {
+     CFG orig = generate(gen, set[i], nregs, ninsts, lvn);
+     CFG dce_cfg = generate(gen, set[i], nregs, ninsts, lvn);
+     CFG adce_cfg = generate(gen, set[i], nregs, ninsts, lvn);
+     int ninsts_before = count_insts(orig);
+
+     double dce_time_taken, adce_time_taken;
+     DCEStats dce_stats, adce_stats;
+     TIME_STMT(dce_stats = dce(dce_cfg, nregs - 1), dce_time_taken);
+     TIME_STMT(adce_stats = adce(adce_cfg, nregs - 1), adce_time_taken);
+
+     InterpResult before = interpret(orig, nregs - 1, max_steps);
+     InterpResult after = interpret(dce_cfg, nregs - 1, max_steps);
+     assert(same_output(before, after));
+     after.free();
+     after = interpret(adce_cfg, nregs - 1, max_steps);
+     assert(same_output(before, after));
+     after.free();
+     before.free();
+
+     const char *what = lvn ? " (after LVN)" : "";
+     printf("Benchmark DCE%s: %d elements, %d instructions: %.4lfs "
+            "(%d removed, %d rounds)\n", what, set[i], ninsts_before,
+            dce_time_taken, dce_stats.removed, dce_stats.rounds);
+     printf("Benchmark ADCE%s: %d elements, %d instructions: %.4lfs "
+            "(%d removed, %d branches became jumps)\n", what, set[i],
+            ninsts_before, adce_time_taken, adce_stats.removed,
+            adce_stats.branches_folded);
+     adce_cfg.destruct();
+     dce_cfg.destruct();
+     orig.destruct();
+   }
+ }
+ printf("\n");
+}
+
+// The instructions removed from the examples of /IR, after LVN.
+static
+void ir_files_report(void) {
+ glob_t files;
+ assert(glob("../IR/*.ir", 0, NULL, &files) == 0);
+ printf("--- /IR (after LVN) ---\n");
+ LOOP(i, 0, (int) files.gl_pathc) {
+   const char *path = files.gl_pathv[i];
+   int max_reg;
+   CFG dce_cfg = parse_procedure(path, &max_reg);
+   CFG adce_cfg = parse_procedure(path, NULL);
+   LVN lvn;
+   lvn.apply_all(dce_cfg);
+   lvn.apply_all(adce_cfg);
+   lvn.free();
+   int ninsts = count_insts(dce_cfg);
+   DCEStats dce_stats = dce(dce_cfg, max_reg);
+   DCEStats adce_stats = adce(adce_cfg, max_reg);
+   printf("%s: instructions: %d, removed by DCE: %d, by ADCE: %d\n", path,
+          ninsts, dce_stats.removed, adce_stats.removed);
+   adce_cfg.destruct();
+   dce_cfg.destruct();
+ }
+ globfree(&files);
+ printf("\n");
+}
+
+int main() {
+  ir_files_report();
+  dce_benchmark("FwdBack", fwdback_cfg, 3);
+  // Every block is control dependent on the branches of all the loops
+  // around it, so the CDG is quadratic here (about 1G dependences for 64k
+  // blocks).
+  dce_benchmark("DeepLoops", deep_loops_cfg, 2);
+  dce_benchmark("Irreducible", irreducible_cfg, 3);
+
+  return 0;
+}
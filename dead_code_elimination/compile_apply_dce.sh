@@ -0,0 +1,2 @@
+g++ apply_dce.cpp -o apply_dce
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
@@ -0,0 +1,423 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stack.h"
+#include "../common/stefanos.h"
+#include "../common/traversal.h"
+#include "../dominance/cdg.h"
+#include "../live_information/liveout.h"
+
+/*
+Dead code elimination. The only thing that a procedure does is PRINT (and
+decide where to go), so a DEF whose register is not live after it is dead.
+
+1) `dce()`: Liveness-driven. Every block is walked backwards from its
+   LiveOut and a DEF of a register that is not live is unlinked. Removing
+   it removes its uses, so the registers it used may become dead in the
+   predecessors. Instead of computing liveness again, we keep the LiveIn of
+   every block and, when the walk of a block shrinks it, the predecessors
+   are walked again (a worklist, like `liveout_worklist_solve()`).
+
+   The sets only shrink, so a register that keeps itself alive around a
+   loop (e.g. `%1 <- %1 + 1` and no other use) is still live after its
+   last real use is gone. So, if anything was removed, liveness is computed
+   from scratch and we go again (a round), until a round removes nothing.
+   Even then, such a register is not removed if it's used in the loop by
+   itself from the start; that's what the aggressive version is for.
+
+2) `adce()`: Aggressive (Cytron et al.; also Engineering a Compiler,
+   Section 10.2). Nothing is live unless proven useful: The PRINTs are
+   useful. A DEF is useful if its register is live after it, where only the
+   useful instructions use registers. A branch is useful if a block that is
+   control dependent on it (see /dominance/cdg.h) has a useful instruction.
+   This is solved like liveness (a worklist), but the sets start empty and
+   only grow. Then, the DEFs that are not useful are removed and a branch
+   that is not useful becomes a jump to the nearest post-dominator with
+   something useful in it (all the blocks in between do nothing). If there's
+   no such post-dominator, the branch is kept (and it's useful).
+
+   A loop that does nothing useful is skipped, even if it would not
+   terminate.
+
+Unreachable blocks are not touched (they're not in the liveness, see
+liveout.h).
+*/
+
+typedef struct DCEStats {
+  // DEFs removed
+  int removed;
+  // Branches that became jumps (only `adce()`)
+  int branches_folded;
+  // Rounds of `dce()` (i.e. times liveness was computed) or of marking
+  // for `adce()`.
+  int rounds;
+} DCEStats;
+
+static
+void dce_use(Value v, BitSet live) {
+  if (val_kind(v) == VAL_REG) {
+    bset_add(live, val_strip_kind(v));
+  }
+}
+
+static
+void dce_use_op(Operation op, BitSet live) {
+  dce_use(op.lhs, live);
+  if (op.kind == OP_ADD) {
+    dce_use(op.rhs, live);
+  }
+}
+
+// Walk `bb` backwards, removing the dead DEFs. `live` is the LiveOut of
+// `bb` and it becomes the LiveIn.
+static
+void dce_block(BasicBlock *bb, BitSet live, DCEStats *stats) {
+  auto *node = bb->insts.tail;
+  while (node) {
+    Instruction *inst = (Instruction *) node;
+    node = node->prev;
+    switch (inst->kind) {
+    case INST::DEF:
+      if (!bset_is_in(live, inst->reg)) {
+        inst->unlink();
+        delete inst;
+        ++stats->removed;
+        continue;
+      }
+      bset_remove(live, inst->reg);
+      dce_use_op(inst->op, live);
+      break;
+    case INST::PRINT:
+      dce_use_op(inst->op, live);
+      break;
+    case INST::BR_COND:
+      dce_use(inst->cond_val, live);
+      break;
+    case INST::BR_UNCOND:
+      break;
+    default:
+      assert(0);
+    }
+  }
+}
+
+// LiveOut(b) = U LiveIn(s), for every successor `s`.
+static
+void dce_live_out(CFG cfg, int b, const Buf<BitSet> LiveIn, BitSet out) {
+  bset_clear(out);
+  for (int succ : cfg.bbs[b].succs) {
+    union_equal_sets_in_place(out, LiveIn[succ]);
+  }
+}
+
+// A FIFO of blocks where every block is at most once (like the one of
+// `liveout_worklist_solve()`).
+typedef struct DCEWorklist {
+  Buf<int> queue;
+  BitSet in;
+  int head, count;
+
+  DCEWorklist(int nbbs) {
+    queue.reserve_and_set(nbbs);
+    in = bset(nbbs);
+    head = count = 0;
+  }
+
+  void push(int b) {
+    if (bset_is_in(in, b))
+      return;
+    bset_add(in, b);
+    queue[(head + count) % queue.len()] = b;
+    ++count;
+  }
+
+  int pop() {
+    int b = queue[head];
+    head = (head + 1) % queue.len();
+    --count;
+    bset_remove(in, b);
+    return b;
+  }
+
+  void free() {
+    queue.free();
+    bset_free(in);
+  }
+} DCEWorklist;
+
+static
+DCEStats dce(CFG cfg, int max_register) {
+  DCEStats stats = {0, 0, 0};
+  int nbbs = cfg.size();
+  if (!nbbs)
+    return stats;
+  const Buf<int> postorder = cfg_postorder(cfg);
+  const Buf<int> post_num = cfg_postorder_numbers(cfg);
+  BitSet live = bset(max_register + 1);
+  DCEWorklist worklist(nbbs);
+  while (true) {
+    int removed = stats.removed;
+    LiveInfo li = liveness(cfg, max_register);
+    ++stats.rounds;
+    for (int b : postorder) {
+      worklist.push(b);
+    }
+    while (worklist.count) {
+      int b = worklist.pop();
+      dce_live_out(cfg, b, li.LiveIn, li.LiveOut[b]);
+      bset_copy(live, li.LiveOut[b]);
+      dce_block(&cfg.bbs[b], live, &stats);
+      if (bset_eq(live, li.LiveIn[b]))
+        continue;
+      bset_copy(li.LiveIn[b], live);
+      for (int pred : cfg.bbs[b].preds) {
+        if (post_num[pred] != -1) {
+          worklist.push(pred);
+        }
+      }
+    }
+    li.free();
+    if (stats.removed == removed)
+      break;
+  }
+  worklist.free();
+  bset_free(live);
+  return stats;
+}
+
+struct ADCE {
+  ADCE(CFG _cfg, int max_register) : cfg(_cfg), worklist(_cfg.size()) {
+    int nbbs = cfg.size();
+    int nregs = max_register + 1;
+    post_num = cfg_postorder_numbers(cfg);
+    cdg = control_dependence_graph(cfg);
+    // Number the instructions: The ones of `b` are
+    // [first[b], first[b + 1]), in order.
+    first.reserve_and_set(nbbs + 1);
+    first[0] = 0;
+    LOOP(b, 0, nbbs) {
+      first[b + 1] = first[b] + cfg.bbs[b].insts.size;
+    }
+    marked.reserve_and_set(first[nbbs]);
+    memset(marked.data, 0, first[nbbs] * sizeof(bool));
+    useful.reserve_and_set(nbbs);
+    memset(useful.data, 0, nbbs * sizeof(bool));
+    LiveIn.reserve_and_set(nbbs);
+    LOOP(b, 0, nbbs) {
+      LiveIn[b] = bset(nregs);
+    }
+    live = bset(nregs);
+  }
+
+  DCEStats apply() {
+    DCEStats stats = {0, 0, 0};
+    int nbbs = cfg.size();
+    if (!nbbs)
+      return stats;
+    const Buf<int> postorder = cfg_postorder(cfg);
+    for (int b : postorder) {
+      int idx = first[b];
+      for (Instruction *inst : cfg.bbs[b].insts) {
+        if (inst->kind == INST::PRINT) {
+          mark(b, idx);
+        }
+        ++idx;
+      }
+      worklist.push(b);
+    }
+    // Mark until the branches that we can't turn into jumps are marked.
+    bool changed = true;
+    while (changed) {
+      ++stats.rounds;
+      solve();
+      changed = false;
+      for (int b : postorder) {
+        Instruction *term = cfg.bbs[b].terminator();
+        if (term && term->kind == INST::BR_COND && !marked[first[b + 1] - 1] &&
+            jump_target(b) == -1) {
+          mark(b, first[b + 1] - 1);
+          changed = true;
+        }
+      }
+    }
+    sweep(&stats);
+    return stats;
+  }
+
+  void free() {
+    cdg.free();
+    first.free();
+    marked.free();
+    useful.free();
+    for (BitSet s : LiveIn) {
+      bset_free(s);
+    }
+    LiveIn.free();
+    bset_free(live);
+    worklist.free();
+  }
+
+private:
+  // Mark the instruction no. `idx` of block `b`. The branches of the blocks
+  // that `b` is control dependent on become useful too.
+  void mark(int b, int idx) {
+    if (marked[idx])
+      return;
+    marked[idx] = true;
+    worklist.push(b);
+    if (useful[b])
+      return;
+    useful[b] = true;
+    Stack<int> stack;
+    stack.push(b);
+    while (!stack.empty()) {
+      int x = stack.pop();
+      for (const int *c = cdg.controllers_begin(x); c != cdg.controllers_end(x); ++c) {
+        if (post_num[*c] == -1)
+          continue;
+        Instruction *term = cfg.bbs[*c].terminator();
+        int term_idx = first[*c + 1] - 1;
+        if (!term || term->kind != INST::BR_COND || marked[term_idx])
+          continue;
+        marked[term_idx] = true;
+        worklist.push(*c);
+        if (!useful[*c]) {
+          useful[*c] = true;
+          stack.push(*c);
+        }
+      }
+    }
+    stack.free();
+  }
+
+  // Useful liveness: Like liveness, but only the marked instructions use
+  // registers, and a DEF of a live register is marked.
+  void solve() {
+    while (worklist.count) {
+      int b = worklist.pop();
+      bset_clear(live);
+      for (int succ : cfg.bbs[b].succs) {
+        union_equal_sets_in_place(live, LiveIn[succ]);
+      }
+      int idx = first[b + 1];
+      for (auto *node = cfg.bbs[b].insts.tail; node; node = node->prev) {
+        Instruction *inst = (Instruction *) node;
+        --idx;
+        switch (inst->kind) {
+        case INST::DEF:
+          if (!marked[idx] && !bset_is_in(live, inst->reg))
+            break;
+          mark(b, idx);
+          bset_remove(live, inst->reg);
+          dce_use_op(inst->op, live);
+          break;
+        case INST::PRINT:
+          dce_use_op(inst->op, live);
+          break;
+        case INST::BR_COND:
+          if (marked[idx]) {
+            dce_use(inst->cond_val, live);
+          }
+          break;
+        case INST::BR_UNCOND:
+          break;
+        default:
+          assert(0);
+        }
+      }
+      if (bset_eq(live, LiveIn[b]))
+        continue;
+      bset_copy(LiveIn[b], live);
+      for (int pred : cfg.bbs[b].preds) {
+        if (post_num[pred] != -1) {
+          worklist.push(pred);
+        }
+      }
+    }
+  }
+
+  // The nearest post-dominator of `b` with a useful instruction or -1.
+  int jump_target(int b) const {
+    int t = cdg.ipdom(b);
+    while (t != -1 && !useful[t]) {
+      t = cdg.ipdom(t);
+    }
+    return t;
+  }
+
+  void sweep(DCEStats *stats) {
+    int nbbs = cfg.size();
+    bool folded = false;
+    LOOP(b, 0, nbbs) {
+      if (post_num[b] == -1)
+        continue;
+      BasicBlock *bb = &cfg.bbs[b];
+      int idx = first[b];
+      auto *node = bb->insts.head;
+      while (node) {
+        Instruction *inst = (Instruction *) node;
+        node = node->next;
+        bool keep = marked[idx++];
+        if (keep || inst->kind == INST::PRINT || inst->kind == INST::BR_UNCOND)
+          continue;
+        if (inst->kind == INST::DEF) {
+          inst->unlink();
+          delete inst;
+          ++stats->removed;
+          continue;
+        }
+        assert(inst->kind == INST::BR_COND);
+        int target = jump_target(b);
+        assert(target != -1);
+        Instruction *jump = Instruction::br_uncond(target);
+        jump->set_parent(bb);
+        inst->insert_before(jump);
+        inst->unlink();
+        delete inst;
+        bb->succs.clear();
+        bb->succs.push(target);
+        ++stats->branches_folded;
+        folded = true;
+      }
+    }
+    if (!folded)
+      return;
+    // Rebuild the predecessors from the successors. Going over the blocks
+    // in order keeps the order of the parser.
+    for (BasicBlock &bb : cfg.bbs) {
+      bb.preds.clear();
+    }
+    for (BasicBlock &bb : cfg.bbs) {
+      for (int succ : bb.succs) {
+        cfg.bbs[succ].preds.push(bb.num);
+      }
+    }
+    cfg.invalidate_traversals();
+  }
+
+  /// Members ///
+
+  CFG cfg;
+  Buf<int> post_num;
+  ControlDependenceGraph cdg;
+  Buf<int> first;
+  Buf<bool> marked;
+  // Blocks with a marked instruction.
+  Buf<bool> useful;
+  Buf<BitSet> LiveIn;
+  BitSet live;
+  DCEWorklist worklist;
+};
+
+static
+DCEStats adce(CFG cfg, int max_register) {
+  ADCE a(cfg, max_register);
+  DCEStats stats = a.apply();
+  a.free();
+  return stats;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <assert.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int streq(const char *a, const char *b) {
+    return !strcmp(a, b);
+}
+
+int ends_with(const char *str, const char *needle, int *len) {
+    assert(str);
+    assert(needle);
+    int nlen = strlen(needle);
+    int slen = strlen(str);
+    *len = slen;
+    if (!nlen || !slen) return 0;
+    if (slen < nlen) return 0;
+    str = str + slen - nlen;
+    while (*str) {
+        if (*str++ != *needle++) return 0;
+    }
+    return 1;
+}
+
+int main()
+{
+    DIR *src;
+    struct dirent *entry;
+
+    int ext_len = strlen(".ir");
+
+    const char *dir = "./";
+
+    src = opendir(dir);
+    assert(src);
+    while ((entry = readdir(src)))
+    {
+        int namelen;
+        if (ends_with(entry->d_name, ".ir", &namelen))
+        {
+            char buf[512];
+            struct stat st;
+            printf("- %s\n", entry->d_name);
+            sprintf(buf, "./%.*s.out", namelen - ext_len, entry->d_name);
+            if (access(buf, F_OK) == -1) {
+                printf("\t\033[1;31m No .out \033[0m\n");
+                continue;
+            }
+            sprintf(buf, "../apply_dce %s/%s > curr_out", dir, entry->d_name);
+            system(buf);
+            sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
+            system(buf);
+            system("rm curr_out");
+            stat("curr_diff", &st);
+            if (st.st_size != 0) {
+                printf("MISMATCH in %s\n", entry->d_name);
+                break;
+            } else {
+                printf("\t\033[1;32m SUCCESS \033[0m\n");
+                system("rm curr_diff");
+            }
+            // Aggressive, if there's a .adce.out
+            const char *flags[] = { "-aggressive" };
+            const char *outs[] = { ".adce.out" };
+            int failed = 0;
+            for (int i = 0; i < 1; ++i) {
+                sprintf(buf, "./%.*s%s", namelen - ext_len, entry->d_name, outs[i]);
+                if (access(buf, F_OK) == -1)
+                    continue;
+                sprintf(buf, "../apply_dce %s %s/%s > curr_out", flags[i], dir, entry->d_name);
+                system(buf);
+                sprintf(buf, "diff curr_out ./%.*s%s > curr_diff", namelen - ext_len, entry->d_name, outs[i]);
+                system(buf);
+                system("rm curr_out");
+                stat("curr_diff", &st);
+                if (st.st_size != 0) {
+                    printf("MISMATCH in %s (%s)\n", entry->d_name, flags[i]);
+                    failed = 1;
+                    break;
+                } else {
+                    printf("\t\033[1;32m SUCCESS (%s) \033[0m\n", flags[i]);
+                    system("rm curr_diff");
+                }
+            }
+            if (failed)
+                break;
+        }
+    }
+    closedir(src);
+
+    return(0);
+}
@@ -1,12 +1,17 @@
 #include "dtree.h"
 #include "dataflow.h"
 #include "lengauer-tarjan.h"
+#include "dom_frontiers.h"
+#include "idf.h"
+#include "cdg.h"
 
 /* Benchmark utilities */
 
 static
 void dtree_benchmark_comp_and_count(CFG cfg, int nelems) {
- double chk_time_taken, lt_slow_time_taken, dataflow_time_taken;
+ double chk_time_taken, lt_slow_time_taken, dataflow_time_taken, scc_time_taken;
+ Buf<BitSet> doms, scc_doms;
+ int evals, scc_evals;
  DominatorTree dtree(cfg.size());
  Buf<int> idom;
  idom.reserve_and_set(cfg.size());
@@ -15,14 +20,23 @@ void dtree_benchmark_comp_and_count(CFG cfg, int nelems) {
  // Slow time is practically no different from fast (i.e., with path compression)
  // for sizes even up to 32000
  TIME_STMT(lt_slow(cfg, idom), lt_slow_time_taken);
- TIME_STMT(compute_dominators(cfg), dataflow_time_taken);
+ TIME_STMT(doms = compute_dominators(cfg, &evals), dataflow_time_taken);
+ TIME_STMT(scc_doms = compute_dominators_scc(cfg, &scc_evals), scc_time_taken);
+ LOOP(bb, 0, cfg.size()) {
+   assert(bset_eq(doms[bb], scc_doms[bb]));
+ }
 
+ dominators_free(doms);
+ dominators_free(scc_doms);
  idom.free();
  dtree.free();
 
  printf("Benchmark CHK: %d elements: %.4lfs\n", nelems, chk_time_taken);
  printf("Benchmark Lengauer-Tarjan Slow: %d elements: %.4lfs\n", nelems, lt_slow_time_taken);
- printf("Benchmark Dataflow: %d elements: %.4lfs\n", nelems, dataflow_time_taken);
+ printf("Benchmark Dataflow: %d elements: %.4lfs (%d evaluations)\n", nelems,
+        dataflow_time_taken, evals);
+ printf("Benchmark Dataflow SCC: %d elements: %.4lfs (%d evaluations)\n", nelems,
+        scc_time_taken, scc_evals);
 }
 
 static
@@ -66,8 +80,226 @@ void dtree_benchmark(void) {
  printf("\n");
 }
 
+// Dense DF is only run up to `max_dense` elements because
+// its memory is quadratic.
+static
+void df_benchmark_comp(CFG cfg, int nelems, int max_dense) {
+ double dense_time_taken, sparse_time_taken;
+ DominatorTree dtree(cfg);
+
+ if (nelems <= max_dense) {
+   DominanceFrontiers dense;
+   TIME_STMT(dense = dom_frontiers(cfg, dtree), dense_time_taken);
+   dom_frontiers_free(dense);
+   printf("Benchmark Dense DF: %d elements: %.4lfs\n", nelems, dense_time_taken);
+ }
+
+ SparseDominanceFrontiers sparse;
+ TIME_STMT(sparse = sparse_dom_frontiers(cfg, dtree), sparse_time_taken);
+ printf("Benchmark Sparse DF: %d elements: %.4lfs (%ld entries)\n", nelems,
+        sparse_time_taken, sparse.blocks.len());
+ sparse.free();
+ dtree.free();
+}
+
+static
+void df_benchmark(void) {
+ int set[] = { 1000, 8000, 16000, 32000, 64000 };
+ // CHK is quadratic on ManyPred, so only FwdBack goes further.
+ int large_set[] = { 1000, 8000, 16000, 32000, 64000, 256000, 1000000 };
+ int max_dense = 32000;
+ printf("--- DF FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(large_set)) {
+   CFG cfg = fwdback_cfg(large_set[i]);
+   df_benchmark_comp(cfg, large_set[i], max_dense);
+   cfg.destruct();
+ }
+ printf("\n");
+ printf("--- DF ManyPred ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = manypred_cfg(set[i]);
+   df_benchmark_comp(cfg, set[i], max_dense);
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// Compute the IDF of `nvars` variables, each defined in `ndefs`
+// (pseudo-)random blocks, with the IDFCalculator and with the naive
+// union of dense DF sets. The results are checked to be the same.
+static
+void idf_benchmark_comp(CFG cfg, int nelems, int nvars, int ndefs) {
+ double df_time_taken, naive_time_taken, setup_time_taken, idf_time_taken;
+ DominatorTree dtree(cfg);
+ Buf<Buf<int>> defs;
+ defs.reserve_and_set(nvars);
+ srand(nelems);
+ LOOP(v, 0, nvars) {
+   new (&defs[v]) Buf<int>();
+   LOOP(d, 0, ndefs) {
+     defs[v].push(rand() % nelems);
+   }
+ }
+
+ DominanceFrontiers dfronts;
+ TIME_STMT(dfronts = dom_frontiers(cfg, dtree), df_time_taken);
+ Buf<Buf<int>> naive_idfs;
+ naive_idfs.reserve_and_set(nvars);
+ naive_idfs.initialize();
+ TIME_STMT(
+   LOOP(v, 0, nvars) {
+     idf_naive(dfronts, defs[v], &naive_idfs[v]);
+   }, naive_time_taken);
+
+ IDFCalculator *calc;
+ TIME_STMT(calc = new IDFCalculator(cfg, dtree), setup_time_taken);
+ Buf<int> idf;
+ int total = 0;
+ TIME_STMT(
+   LOOP(v, 0, nvars) {
+     calc->compute(defs[v], &idf);
+     total += idf.len();
+   }, idf_time_taken);
+
+ // Check the last one and the total size, for all of them the cost
+ // would be significant.
+ int naive_total = 0;
+ LOOP(v, 0, nvars) {
+   naive_total += naive_idfs[v].len();
+ }
+ assert(naive_total == total);
+ assert(idf.len() == naive_idfs[nvars - 1].len());
+ LOOP(i, 0, idf.len()) {
+   assert(idf[i] == naive_idfs[nvars - 1][i]);
+ }
+
+ printf("Benchmark Naive IDF: %d elements, %d vars: %.4lfs (+ %.4lfs for the DF sets)\n",
+        nelems, nvars, naive_time_taken, df_time_taken);
+ printf("Benchmark IDFCalculator: %d elements, %d vars: %.4lfs (+ %.4lfs setup)\n",
+        nelems, nvars, idf_time_taken, setup_time_taken);
+
+ idf.free();
+ calc->free();
+ delete calc;
+ LOOP(v, 0, nvars) {
+   defs[v].free();
+   naive_idfs[v].free();
+ }
+ defs.free();
+ naive_idfs.free();
+ dom_frontiers_free(dfronts);
+ dtree.free();
+}
+
+// None of the generators has a loop of the entry to itself. The entry is its
+// own idom, but that edge is a J-edge, so a definition in the entry needs a
+// phi in the entry. Checked against the naive IDF, for every def set.
+static
+void idf_entry_loop_check(int nelems) {
+ CFG cfg = linear_cfg(nelems);
+ cfg.add_edge(0, 0);
+ DominatorTree dtree(cfg);
+ DominanceFrontiers dfronts = dom_frontiers(cfg, dtree);
+ IDFCalculator calc(cfg, dtree);
+ Buf<int> defs, idf, naive_idf;
+ LOOP(b, 0, nelems) {
+   defs.clear();
+   defs.push(b);
+   defs.push(nelems - 1);
+   calc.compute(defs, &idf);
+   idf_naive(dfronts, defs, &naive_idf);
+   assert(idf.len() == naive_idf.len());
+   LOOP(i, 0, idf.len()) {
+     assert(idf[i] == naive_idf[i]);
+   }
+   // Only the entry is in a loop.
+   assert(idf.len() == (b == 0));
+ }
+ printf("IDF EntryLoop: %d elements: OK\n", nelems);
+ defs.free();
+ idf.free();
+ naive_idf.free();
+ calc.free();
+ dom_frontiers_free(dfronts);
+ dtree.free();
+ cfg.destruct();
+}
+
+static
+void idf_benchmark(void) {
+ int set[] = { 1000, 4000, 16000 };
+ int nvars = 200, ndefs = 4;
+ printf("--- IDF FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = fwdback_cfg(set[i]);
+   idf_benchmark_comp(cfg, set[i], nvars, ndefs);
+   cfg.destruct();
+ }
+ printf("\n");
+ printf("--- IDF ManyPred ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = manypred_cfg(set[i]);
+   idf_benchmark_comp(cfg, set[i], nvars, ndefs);
+   cfg.destruct();
+ }
+ printf("\n");
+ printf("--- IDF EntryLoop ---\n");
+ idf_entry_loop_check(1000);
+ printf("\n");
+}
+
+static
+void cdg_benchmark(void) {
+ int set[] = { 1000, 8000, 16000, 32000, 64000 };
+ printf("--- CDG ManyPred ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = manypred_cfg(set[i]);
+   double time_taken;
+   ControlDependenceGraph cdg;
+   TIME_STMT(cdg = control_dependence_graph(cfg), time_taken);
+   printf("Benchmark CDG: %d elements: %.4lfs (%ld dependences)\n", set[i],
+          time_taken, cdg.ctrl_blocks.len());
+   cdg.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// The first `cfg_postorder()` computes the order and the rest get
+// it from the cache, until the CFG changes.
+static
+void traversal_benchmark(void) {
+ int set[] = { 1000, 64000, 1000000, 4000000 };
+ printf("--- Traversals Linear ---\n");
+ Traversal t;
+ Buf<int> order;
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = linear_cfg(set[i]);
+   double cold_time_taken, cached_time_taken, bfs_time_taken, chk_time_taken;
+   TIME_STMT(cfg_postorder(cfg), cold_time_taken);
+   TIME_STMT(cfg_postorder(cfg), cached_time_taken);
+   TIME_STMT(t.bfs(cfg, 0, DIR::FORWARD, &order), bfs_time_taken);
+   DominatorTree dtree(cfg.size());
+   TIME_STMT(dtree.build(cfg), chk_time_taken);
+   printf("Benchmark Postorder: %d elements: %.4lfs (cached: %.6lfs)\n",
+          set[i], cold_time_taken, cached_time_taken);
+   printf("Benchmark BFS: %d elements: %.4lfs\n", set[i], bfs_time_taken);
+   printf("Benchmark CHK (cached postorder): %d elements: %.4lfs\n",
+          set[i], chk_time_taken);
+   dtree.free();
+   cfg.destruct();
+ }
+ order.free();
+ t.free();
+ printf("\n");
+}
+
 int main() {
+  traversal_benchmark();
   dtree_benchmark();
+  df_benchmark();
+  idf_benchmark();
+  cdg_benchmark();
 
   return 0;
 }
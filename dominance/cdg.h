@@ -0,0 +1,205 @@
+#ifndef CDG_H
+#define CDG_H
+
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stack.h"
+#include "../common/stefanos.h"
+#include "dom_frontiers.h"
+#include "dtree.h"
+
+/*
+Control Dependence Graph (Ferrante, Ottenstein, Warren; also Cytron et al.).
+Block `Y` is control dependent on block `X` iff `X` is in the post-dominance
+frontier of `Y`, i.e. `X` has a successor post-dominated by `Y` but `Y` does not
+strictly post-dominate `X`. So, the "controllers" of `Y` are the branch blocks
+that decide whether `Y` executes.
+
+Post-dominance is dominance on the reverse CFG, so we build the reverse CFG
+and reuse DominatorTree and the runner walk of `sparse_dom_frontiers()` as
+they are. The reverse CFG has a virtual exit as node 0, which is the entry of
+the reverse CFG (DominatorTree requires the entry to be 0), and block `b` is
+node `b + 1`. The virtual exit has an edge to every block without successors.
+
+Blocks that can't reach an exit (infinite loops) would not be part of the
+post-dominator tree, so we also connect the virtual exit to one block
+of every such region (the one with the highest number), as LLVM does.
+
+Blocks that always execute (once the entry does) have no controllers.
+*/
+
+// Build the reverse CFG described above.
+static
+CFG reverse_cfg_with_exit(const CFG cfg) {
+  int nbbs = cfg.size();
+  CFG rev(nbbs + 1);
+  LOOP(b, 0, nbbs) {
+    for (int succ : cfg.bbs[b].succs) {
+      rev.add_edge(succ + 1, b + 1);
+    }
+  }
+  LOOP(b, 0, nbbs) {
+    if (!cfg.bbs[b].succs.len()) {
+      rev.add_edge(0, b + 1);
+    }
+  }
+
+  // Find the blocks that don't reach an exit, i.e. that are not reachable
+  // from the virtual exit in the reverse CFG.
+  BitSet reached = bset(nbbs + 1);
+  Stack<int> stack;
+  stack.push(0);
+  bset_add(reached, 0);
+  int next_candidate = nbbs;
+  while (true) {
+    while (!stack.empty()) {
+      int n = stack.pop();
+      for (int succ : rev.bbs[n].succs) {
+        if (!bset_is_in(reached, succ)) {
+          bset_add(reached, succ);
+          stack.push(succ);
+        }
+      }
+    }
+    while (next_candidate > 0 && bset_is_in(reached, next_candidate)) {
+      --next_candidate;
+    }
+    if (next_candidate == 0)
+      break;
+    rev.add_edge(0, next_candidate);
+    bset_add(reached, next_candidate);
+    stack.push(next_candidate);
+  }
+  stack.free();
+  bset_free(reached);
+  return rev;
+}
+
+typedef struct ControlDependenceGraph {
+  // CSR: The controllers of `b`, i.e. the blocks that `b` is control
+  // dependent on, are `ctrl_blocks[ctrl_offsets[b] .. ctrl_offsets[b+1])`,
+  // sorted.
+  Buf<int> ctrl_offsets;
+  Buf<int> ctrl_blocks;
+  // CSR: The blocks that are control dependent on `x` (the inverse
+  // of the above), sorted.
+  Buf<int> dep_offsets;
+  Buf<int> dep_blocks;
+  // Immediate post-dominator of every block or -1 if it is the virtual exit.
+  Buf<int> ipdoms;
+
+  int num_controllers(int bb) const {
+    return ctrl_offsets[bb + 1] - ctrl_offsets[bb];
+  }
+
+  const int *controllers_begin(int bb) const {
+    return &ctrl_blocks.data[ctrl_offsets[bb]];
+  }
+
+  const int *controllers_end(int bb) const {
+    return &ctrl_blocks.data[ctrl_offsets[bb + 1]];
+  }
+
+  int num_dependents(int bb) const {
+    return dep_offsets[bb + 1] - dep_offsets[bb];
+  }
+
+  const int *dependents_begin(int bb) const {
+    return &dep_blocks.data[dep_offsets[bb]];
+  }
+
+  const int *dependents_end(int bb) const {
+    return &dep_blocks.data[dep_offsets[bb + 1]];
+  }
+
+  // Return true if `bb` is control dependent on `x`.
+  bool is_control_dependent(int bb, int x) const {
+    // Binary search in the sorted controllers of `bb`
+    int lo = ctrl_offsets[bb];
+    int hi = ctrl_offsets[bb + 1];
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (ctrl_blocks[mid] < x) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo < ctrl_offsets[bb + 1] && ctrl_blocks[lo] == x;
+  }
+
+  int ipdom(int bb) const {
+    return ipdoms[bb];
+  }
+
+  ssize_t size() const {
+    return ipdoms.len();
+  }
+
+  void free() {
+    ctrl_offsets.free();
+    ctrl_blocks.free();
+    dep_offsets.free();
+    dep_blocks.free();
+    ipdoms.free();
+  }
+} ControlDependenceGraph;
+
+static
+ControlDependenceGraph control_dependence_graph(const CFG cfg) {
+  int nbbs = cfg.size();
+  CFG rev = reverse_cfg_with_exit(cfg);
+  DominatorTree pdtree(rev);
+  SparseDominanceFrontiers pdf = sparse_dom_frontiers(rev, pdtree);
+
+  ControlDependenceGraph cdg;
+
+  cdg.ipdoms.reserve_and_set(nbbs);
+  LOOP(b, 0, nbbs) {
+    cdg.ipdoms[b] = pdtree.idom(b + 1) - 1;
+  }
+
+  // Controllers: PDF(b + 1), shifted back to block numbers. The virtual
+  // exit is never in a PDF because it has no predecessors in the reverse CFG.
+  cdg.ctrl_offsets.reserve_and_set(nbbs + 1);
+  cdg.ctrl_blocks.reserve_and_set(pdf.blocks.len());
+  cdg.ctrl_offsets[0] = 0;
+  LOOP(b, 0, nbbs) {
+    int len = 0;
+    for (const int *x = pdf.df_begin(b + 1); x != pdf.df_end(b + 1); ++x) {
+      assert(*x != 0);
+      cdg.ctrl_blocks[cdg.ctrl_offsets[b] + len] = *x - 1;
+      ++len;
+    }
+    cdg.ctrl_offsets[b + 1] = cdg.ctrl_offsets[b] + len;
+  }
+
+  // Dependents: transpose with counting. Going over `b` in increasing
+  // order keeps each list sorted.
+  cdg.dep_offsets.reserve_and_set(nbbs + 1);
+  memset(cdg.dep_offsets.data, 0, (nbbs + 1) * sizeof(int));
+  for (int x : cdg.ctrl_blocks) {
+    cdg.dep_offsets[x + 1]++;
+  }
+  LOOP(x, 0, nbbs) {
+    cdg.dep_offsets[x + 1] += cdg.dep_offsets[x];
+  }
+  cdg.dep_blocks.reserve_and_set(cdg.ctrl_blocks.len());
+  Buf<int> cursor;
+  cursor.reserve_and_set(nbbs);
+  memcpy(cursor.data, cdg.dep_offsets.data, nbbs * sizeof(int));
+  LOOP(b, 0, nbbs) {
+    for (const int *x = cdg.controllers_begin(b); x != cdg.controllers_end(b); ++x) {
+      cdg.dep_blocks[cursor[*x]++] = b;
+    }
+  }
+  cursor.free();
+
+  pdf.free();
+  pdtree.free();
+  rev.destruct();
+  return cdg;
+}
+
+#endif
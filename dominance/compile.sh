@@ -1,2 +1,3 @@
 g++ print_dom_fronts.cpp -o print_dom_fronts -Wall -Wno-unused-function -ggdb
-g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
\ No newline at end of file
+g++ print_cdg.cpp -o print_cdg -Wall -Wno-unused-function -ggdb
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
@@ -3,6 +3,8 @@
 
 #include "../common/stack.h"
 #include "../common/bitset.h"
+#include "../common/scc.h"
+#include "../common/traversal.h"
 
 struct AlignedMemory {
   void *ptr;
@@ -36,25 +38,51 @@ void initialize_dom_mem(Buf<BitSet> dominators, size_t number_bbs) {
   }
 }
 
-// TODO: Doesn't return or fill something because
-// currently the batched allocation of `dominators`
-// requires special de-allocation. That's ok, it's
-// only for benchmarking. We could change it if we
-// want to use it.
-void compute_dominators(CFG cfg) {
-  size_t number_bbs = cfg.size();
+// Solve the equation of `bbnum`. Return true if its set changed.
+static
+bool dom_solve_for_bb(CFG cfg, Buf<BitSet> dominators, BitSet temp, int bbnum) {
+  light_all(temp);
+  Buf<int> preds = cfg.bbs[bbnum].preds;
+  LOOP (j, 0, preds.len()) {
+    int pred = preds[j];
+    intersect_equal_sets_in_place(temp, dominators[pred]);
+  }
+  bset_add(temp, bbnum);
+  if (!bset_eq(temp, dominators[bbnum])) {
+    bset_copy(dominators[bbnum], temp);
+    return true;
+  }
+  return false;
+}
+
+// Initialize all the dominator sets except for the entry block
+// (i.e. 0) to all the blocks.
+static
+Buf<BitSet> dominators_alloc(size_t number_bbs) {
   Buf<BitSet> dominators;
   dominators.reserve_and_set(number_bbs);
   initialize_dom_mem(dominators, number_bbs);
-  
-  Buf<int> postorder = postorder_dfs(cfg);
-
-  // Initialize all the dominator sets except for the entry block
-  // (i.e. 0)
   bset_add(dominators[0], 0);
   LOOP(i, 1, number_bbs) {
     light_all(dominators[i]);
   }
+  return dominators;
+}
+
+// The batched allocation of `dominators` requires special de-allocation.
+static
+void dominators_free(Buf<BitSet> dominators) {
+  free(dominators[0].data);
+  dominators.free();
+}
+
+// Round-robin in reverse postorder until nothing changes. `block_evals`
+// (if not NULL) gets the number of times the equation of a block was solved.
+static
+Buf<BitSet> compute_dominators(CFG cfg, int *block_evals = NULL) {
+  size_t number_bbs = cfg.size();
+  Buf<BitSet> dominators = dominators_alloc(number_bbs);
+  const Buf<int> postorder = cfg_postorder(cfg);
 
   // Get aligned memory because a lot of memcpy / memset
   // will happen.
@@ -66,35 +94,67 @@ void compute_dominators(CFG cfg) {
   // but not include the entry block.
   assert(postorder.len() == number_bbs);
   assert(postorder[number_bbs - 1] == 0);
+  int evals = 0;
   bool change;
   do {
     change = false;
 
     LOOP_REV(i, 0, number_bbs - 1) {
       int bbnum = postorder[i];
-      light_all(temp);
-      Buf<int> preds = cfg.bbs[bbnum].preds;
-      LOOP (j, 0, preds.len()) {
-        int pred = preds[j];
-        intersect_equal_sets_in_place(temp, dominators[pred]);
-      }
-      bset_add(temp, i);
-      if (!bset_eq(temp, dominators[bbnum])) {
-        change = true;
-        assert(bset_copy(dominators[bbnum], temp));
-      }
+      change |= dom_solve_for_bb(cfg, dominators, temp, bbnum);
+      ++evals;
     }
   } while (change);
 
-  postorder.free();
-
+  if (block_evals)
+    *block_evals = evals;
   void *revert_offset = mem.ptr - mem.offset;
   free(revert_offset);
-  
-  // Special de-allocation for `dominators` bitsets.
-  free(dominators[0].data);
+  return dominators;
+}
 
-  dominators.free();
+// SCC-ordered: Dominators are a forward problem, so we visit the SCCs
+// in topological order (i.e. decreasing `cfg_sccs()` number) and solve each
+// to a fixpoint (in reverse postorder) before moving on. An acyclic SCC only
+// needs one evaluation because all its predecessors are final. Unreachable
+// blocks are skipped.
+static
+Buf<BitSet> compute_dominators_scc(CFG cfg, int *block_evals = NULL) {
+  size_t number_bbs = cfg.size();
+  Buf<BitSet> dominators = dominators_alloc(number_bbs);
+  const Buf<int> post_num = cfg_postorder_numbers(cfg);
+  SCCs sccs = cfg_sccs(cfg);
+  sccs.order_members_by(cfg_rpo(cfg));
+
+  AlignedMemory mem = aligned_memory<BitSet64, 64>(number_bbs);
+  BitSet temp = bset_mem(number_bbs, mem.ptr);
+
+  int evals = 0;
+  LOOP_REV(c, 0, sccs.size()) {
+    const int *begin = sccs.members_begin(c);
+    const int *end = sccs.members_end(c);
+    // Either all the blocks of an SCC are reachable or none is.
+    if (post_num[*begin] == -1)
+      continue;
+    bool change;
+    do {
+      change = false;
+      for (const int *bb = begin; bb != end; ++bb) {
+        // The entry is fixed.
+        if (*bb == 0)
+          continue;
+        change |= dom_solve_for_bb(cfg, dominators, temp, *bb);
+        ++evals;
+      }
+    } while (change && sccs.is_cyclic(c));
+  }
+
+  if (block_evals)
+    *block_evals = evals;
+  sccs.free();
+  void *revert_offset = mem.ptr - mem.offset;
+  free(revert_offset);
+  return dominators;
 }
 
 #endif
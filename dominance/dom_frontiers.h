@@ -19,11 +19,31 @@ void dom_frontiers_free(DominanceFrontiers dfronts) {
   dfronts.DF.free();
 }
 
+// The entry block also has an implicit edge coming from outside the
+// procedure, so it's a join point as soon as it has a single predecessor.
 static
 int is_join_point(BasicBlock bb) {
+  if (bb.num == 0)
+    return bb.preds.len() > 0;
   return bb.preds.len() > 1;
 }
 
+// The runner walk goes up the dominator tree until it finds idom(n).
+// The entry has no real idom so for it, we walk up to (and including) the
+// entry itself. -1 is returned as the "parent" of the entry to stop there.
+static
+int df_runner_stop(const DominatorTree dtree, int n) {
+  return (n == 0) ? -1 : dtree.idom(n);
+}
+
+static
+int df_runner_next(const DominatorTree dtree, int runner) {
+  return (runner == 0) ? -1 : dtree.idom(runner);
+}
+
+// Dense DF sets, one bitset of `nbbs` bits per block. Constant time
+// membership queries but quadratic memory, so use it only for small CFGs
+// (see `sparse_dom_frontiers()` below).
 static
 DominanceFrontiers dom_frontiers(const CFG cfg, const DominatorTree dtree) {
 
@@ -42,15 +62,18 @@ DominanceFrontiers dom_frontiers(const CFG cfg, const DominatorTree dtree) {
   }
 
   LOOP(n, 0, nbbs) {
-    int idom_of_n = dtree.idom(n);
+    int idom_of_n = df_runner_stop(dtree, n);
     BasicBlock bb = cfg.bbs[n];
     if (is_join_point(bb)) {
       LOOPu32(p, 0, bb.preds.len()) {
         int pred = bb.preds[p];
+        // Unreachable predecessors have no dominators.
+        if (dtree.idom(pred) < 0)
+          continue;
         int runner = pred;
         while (runner != idom_of_n) {
           bset_add(DF[runner], n);
-          runner = dtree.idom(runner);
+          runner = df_runner_next(dtree, runner);
         }
       }
     }
@@ -60,4 +83,128 @@ DominanceFrontiers dom_frontiers(const CFG cfg, const DominatorTree dtree) {
   return dfronts;
 }
 
+/*
+The dense form above needs nbbs * nbbs bits, which is prohibitive
+for big CFGs (e.g. 1M blocks -> 125GB), although real frontiers
+have only a handful of entries per block. `SparseDominanceFrontiers`
+keeps all the frontiers in a single CSR buffer: the DF of block `b`
+is `blocks[offsets[b] .. offsets[b+1])`, sorted in increasing order.
+
+It is built with the same runner walk as above. Instead of a bitset,
+we deduplicate with a per-block marker that remembers the last join
+point that was added to the block's DF. Because join points are visited
+in increasing order, every DF comes out sorted for free.
+*/
+
+typedef struct SparseDominanceFrontiers {
+  Buf<int> offsets;
+  Buf<int> blocks;
+
+  // Number of blocks in DF(bb)
+  int df_size(int bb) const {
+    return offsets[bb + 1] - offsets[bb];
+  }
+
+  // Start of the sorted DF(bb) array
+  const int *df_begin(int bb) const {
+    return &blocks.data[offsets[bb]];
+  }
+
+  const int *df_end(int bb) const {
+    return &blocks.data[offsets[bb + 1]];
+  }
+
+  bool in_df(int bb, int n) const {
+    // Binary search in the sorted DF(bb)
+    int lo = offsets[bb];
+    int hi = offsets[bb + 1];
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (blocks[mid] < n) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo < offsets[bb + 1] && blocks[lo] == n;
+  }
+
+  ssize_t size() const {
+    return offsets.len() - 1;
+  }
+
+  void free() {
+    offsets.free();
+    blocks.free();
+  }
+} SparseDominanceFrontiers;
+
+// Walk the runners of all the join points. If `dest` is NULL,
+// count the size of each DF in `counts`, otherwise append
+// each join point to `dest` at the position pointed by `counts`.
+static
+void sparse_df_walk(const CFG cfg, const DominatorTree dtree,
+                    Buf<int> marker, Buf<int> counts, int *dest) {
+  int nbbs = cfg.size();
+  LOOP(i, 0, nbbs) {
+    marker[i] = -1;
+  }
+  LOOP(n, 0, nbbs) {
+    BasicBlock bb = cfg.bbs[n];
+    if (!is_join_point(bb))
+      continue;
+    int idom_of_n = df_runner_stop(dtree, n);
+    LOOPu32(p, 0, bb.preds.len()) {
+      int runner = bb.preds[p];
+      // Unreachable predecessors have no dominators.
+      if (dtree.idom(runner) < 0)
+        continue;
+      while (runner != idom_of_n && marker[runner] != n) {
+        marker[runner] = n;
+        if (dest) {
+          dest[counts[runner]] = n;
+        }
+        counts[runner]++;
+        runner = df_runner_next(dtree, runner);
+      }
+    }
+  }
+}
+
+static
+SparseDominanceFrontiers sparse_dom_frontiers(const CFG cfg,
+                                              const DominatorTree dtree) {
+  int nbbs = dtree.size();
+  assert(dtree.size() == cfg.size());
+
+  Buf<int> marker;
+  marker.reserve_and_set(nbbs);
+  Buf<int> cursor;
+  cursor.reserve_and_set(nbbs);
+  memset(cursor.data, 0, nbbs * sizeof(int));
+
+  // First pass: count the size of each DF.
+  sparse_df_walk(cfg, dtree, marker, cursor, NULL);
+  Buf<int> offsets;
+  offsets.reserve_and_set(nbbs + 1);
+  offsets[0] = 0;
+  LOOP(i, 0, nbbs) {
+    offsets[i + 1] = offsets[i] + cursor[i];
+  }
+
+  // Second pass: fill. `cursor` now points to the next free
+  // slot of each DF.
+  int total = offsets[nbbs];
+  Buf<int> blocks;
+  blocks.reserve_and_set(total);
+  memcpy(cursor.data, offsets.data, nbbs * sizeof(int));
+  sparse_df_walk(cfg, dtree, marker, cursor, blocks.data);
+
+  cursor.free();
+  marker.free();
+
+  SparseDominanceFrontiers dfronts = { .offsets = offsets, .blocks = blocks };
+  return dfronts;
+}
+
 #endif
@@ -1,10 +1,13 @@
 #ifndef DOMTREE_H
 #define DOMTREE_H
 
+#include <string.h>
+
 #include "../common/cfg.h"
 #include "../common/parser_ir.h"
+#include "../common/stack.h"
 #include "../common/stefanos.h"
-#include "../common/utils.h"
+#include "../common/traversal.h"
 
 #define UNDEFINED_IDOM -1
 
@@ -28,8 +31,9 @@ We use the Cooper, Harvey, Kennedy Algorithm
 struct DominatorTree {
 
   DominatorTree(size_t number_bbs) {
-    // Assert that the user must have accounted for entry and exit.
-    assert(number_bbs >= 2);
+    // A single block is fine: the entry is the root and has
+    // no children.
+    assert(number_bbs >= 1);
     idoms.reserve_and_set(number_bbs);
   }
 
@@ -45,13 +49,9 @@ struct DominatorTree {
 
   void build(CFG cfg) {
     this->initialize();
-    Buf<int> postorder = postorder_dfs(cfg);
-    Buf<int> postorder_map;
-    postorder_map.reserve_and_set(cfg.size());
-    postorder_map[0] = cfg.size() - 1;
-    LOOPu32(i, 0, postorder.len()) {
-      postorder_map[postorder[i]] = i;
-    }
+    // Both are cached on the CFG.
+    const Buf<int> postorder = cfg_postorder(cfg);
+    const Buf<int> postorder_map = cfg_postorder_numbers(cfg);
 
     // The entry block has itself as its immediate dominator.
     idoms[0] = 0;
@@ -64,10 +64,16 @@ struct DominatorTree {
       LOOP_REV(i, 0, postorder.len() - 1) {
         int bb_num = postorder[i];
         BasicBlock bb = cfg.bbs[bb_num];
-        int new_idom = bb.preds[0];
-        LOOP(j, 1, bb.preds.len()) {
-          int pred = bb.preds[j];
-          if (idoms[pred] != UNDEFINED_IDOM) {
+        // Start from the first processed predecessor. In reverse
+        // postorder there is always one, but it is not necessarily
+        // the first in `preds` (e.g. that can be a back edge).
+        int new_idom = UNDEFINED_IDOM;
+        for (int pred : bb.preds) {
+          if (idoms[pred] == UNDEFINED_IDOM)
+            continue;
+          if (new_idom == UNDEFINED_IDOM) {
+            new_idom = pred;
+          } else {
             new_idom = intersect(new_idom, pred, idoms, postorder_map);
           }
         }
@@ -77,9 +83,6 @@ struct DominatorTree {
         }
       }
     } while (change);
-
-    postorder.free();
-    postorder_map.free();
   }
 
   // Return the immediate dominator of `bb`
@@ -123,7 +126,7 @@ struct DominatorTree {
 private:
 
   static 
-  int intersect(int b1, int b2, const Buf<int> idoms, Buf<int> postorder_map) {
+  int intersect(int b1, int b2, const Buf<int> idoms, const Buf<int> postorder_map) {
     while (b1 != b2) {
       if (postorder_map[b1] < postorder_map[b2]) {
         b1 = idoms[b1];
@@ -140,6 +143,133 @@ private:
 };
 
 
+/*
+The DominatorTree above is implicit, so we can only walk from a node
+upwards. ExplicitDomTree materializes the children of each node (in CSR form),
+the level (depth) of each node and a preorder numbering of the tree.
+With the preorder numbering, "Does `a` dominate `b`" is answered in
+constant time: `a` dominates `b` iff pre(a) <= pre(b) <= last(a), where
+last(a) is the largest preorder number in the subtree of `a`.
+
+Unreachable blocks are not part of the tree; they have level -1.
+*/
+
+struct ExplicitDomTree {
+  Buf<int> child_offsets;
+  Buf<int> children;
+  Buf<int> levels;
+  Buf<int> pre;
+  Buf<int> last;
+  // Reachable blocks in dominator-tree preorder.
+  Buf<int> preorder;
+
+  ExplicitDomTree(const DominatorTree dtree) {
+    int nbbs = dtree.size();
+    child_offsets.reserve_and_set(nbbs + 1);
+    levels.reserve_and_set(nbbs);
+    pre.reserve_and_set(nbbs);
+    last.reserve_and_set(nbbs);
+    preorder.reserve(nbbs);
+
+    // Count children (into child_offsets[idom + 1]) and prefix-sum.
+    memset(child_offsets.data, 0, (nbbs + 1) * sizeof(int));
+    LOOP(bb, 1, nbbs) {
+      int idom = dtree.idom(bb);
+      if (idom != UNDEFINED_IDOM) {
+        child_offsets[idom + 1]++;
+      }
+    }
+    LOOP(bb, 0, nbbs) {
+      child_offsets[bb + 1] += child_offsets[bb];
+    }
+    children.reserve_and_set(child_offsets[nbbs]);
+    Buf<int> cursor;
+    cursor.reserve_and_set(nbbs);
+    memcpy(cursor.data, child_offsets.data, nbbs * sizeof(int));
+    LOOP(bb, 1, nbbs) {
+      int idom = dtree.idom(bb);
+      if (idom != UNDEFINED_IDOM) {
+        children[cursor[idom]++] = bb;
+      }
+    }
+    cursor.free();
+
+    LOOP(bb, 0, nbbs) {
+      levels[bb] = -1;
+      pre[bb] = last[bb] = -1;
+    }
+
+    // Iterative DFS to get the preorder. Children are pushed
+    // in reverse so that they are visited in increasing order.
+    Stack<int> stack;
+    stack.push(0);
+    levels[0] = 0;
+    while (!stack.empty()) {
+      int bb = stack.pop();
+      pre[bb] = preorder.len();
+      preorder.push(bb);
+      LOOP_REV(i, child_offsets[bb], child_offsets[bb + 1]) {
+        int child = children[i];
+        levels[child] = levels[bb] + 1;
+        stack.push(child);
+      }
+    }
+    stack.free();
+
+    // In preorder, every node comes after its parent, so going in
+    // reverse we have the `last` of all the children of a node
+    // before we reach it.
+    LOOP_REV(i, 0, preorder.len()) {
+      int bb = preorder[i];
+      int l = pre[bb];
+      LOOP(c, child_offsets[bb], child_offsets[bb + 1]) {
+        l = MAX(l, last[children[c]]);
+      }
+      last[bb] = l;
+    }
+  }
+
+  int level(int bb) const {
+    return levels[bb];
+  }
+
+  int num_children(int bb) const {
+    return child_offsets[bb + 1] - child_offsets[bb];
+  }
+
+  const int *children_begin(int bb) const {
+    return &children.data[child_offsets[bb]];
+  }
+
+  const int *children_end(int bb) const {
+    return &children.data[child_offsets[bb + 1]];
+  }
+
+  bool is_reachable_from_entry(int bb) const {
+    return levels[bb] != -1;
+  }
+
+  // Return true if BB no. `a` dominates BB no. `b`
+  bool dominates(int a, int b) const {
+    if (!is_reachable_from_entry(a) || !is_reachable_from_entry(b))
+      return false;
+    return pre[a] <= pre[b] && pre[b] <= last[a];
+  }
+
+  bool strictly_dominates(int a, int b) const {
+    return a != b && dominates(a, b);
+  }
+
+  void free() {
+    child_offsets.free();
+    children.free();
+    levels.free();
+    pre.free();
+    last.free();
+    preorder.free();
+  }
+};
+
 // Arbitrary useful routines that are meant for debug purposes
 
 static
@@ -0,0 +1,219 @@
+#ifndef IDF_H
+#define IDF_H
+
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stack.h"
+#include "../common/stefanos.h"
+#include "dom_frontiers.h"
+#include "dtree.h"
+
+/*
+Iterated Dominance Frontiers: DF+(S) for a set S of (definition) blocks,
+which is where phi-functions go.
+
+We use the algorithm of Sreedhar and Gao ("A Linear Time Algorithm for Placing
+phi-Nodes"), in the form that LLVM's IDFCalculator uses. It works on the
+DJ-graph, i.e. the dominator tree (D-edges) plus the CFG edges x -> y
+where x is not idom(y) (J-edges). Put simply:
+- The definition blocks are put in a priority queue ordered by their level in
+  the dominator tree (deepest first).
+- For each `root` taken from the queue, we walk the dominator subtree of `root`.
+  For every J-edge x -> y we find, if level(y) <= level(root), then `y` is in
+  DF+(S). It's added to the queue (if it's not already a definition block)
+  because its own DF is also part of the result.
+- A node's subtree is walked only once for all the roots, which is what
+  makes it linear.
+
+The DF sets are never materialized. The priority queue is a "piggybank",
+i.e. one bucket per level. Nodes that we push while processing
+`root` never have a level deeper than `root`, so we only have to move
+downwards in the buckets.
+
+The calculator is meant to be reused for many variables (e.g. all the
+registers of a procedure). All the per-node state is reset with generation
+counters, so every call costs only as much as the part of the DJ-graph
+it visits.
+*/
+
+struct IDFCalculator {
+  IDFCalculator(const CFG _cfg, const DominatorTree dtree) :
+    cfg(_cfg), edt(dtree) {
+    int nbbs = cfg.size();
+    idoms.reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      idoms[bb] = dtree.idom(bb);
+    }
+    int max_level = 0;
+    LOOP(bb, 0, nbbs) {
+      max_level = MAX(max_level, edt.level(bb));
+    }
+    bucket_head.reserve_and_set(max_level + 1);
+    LOOP(l, 0, max_level + 1) {
+      bucket_head[l] = -1;
+    }
+    bucket_next.reserve_and_set(nbbs);
+    def_gen.reserve_and_set(nbbs);
+    in_idf_gen.reserve_and_set(nbbs);
+    visited_gen.reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      def_gen[bb] = in_idf_gen[bb] = visited_gen[bb] = 0;
+    }
+    generation = 0;
+  }
+
+  // Compute DF+(`def_blocks`) and put it in `idf`, sorted by block number.
+  // If `live_in` is not NULL, only blocks in which the variable is live-in
+  // are considered (i.e. for pruned SSA).
+  void compute(const Buf<int> def_blocks, Buf<int> *idf,
+               const BitSet *live_in = NULL) {
+    ++generation;
+    idf->clear();
+
+    int curr_level = -1;
+    for (int bb : def_blocks) {
+      // Unreachable blocks are not in the dominator tree.
+      if (!edt.is_reachable_from_entry(bb))
+        continue;
+      if (def_gen[bb] == generation)
+        continue;
+      def_gen[bb] = generation;
+      push(bb);
+      curr_level = MAX(curr_level, edt.level(bb));
+    }
+
+    while (curr_level >= 0) {
+      int root = bucket_head[curr_level];
+      if (root == -1) {
+        --curr_level;
+        continue;
+      }
+      bucket_head[curr_level] = bucket_next[root];
+      int root_level = curr_level;
+
+      worklist.push(root);
+      visited_gen[root] = generation;
+      while (!worklist.empty()) {
+        int node = worklist.pop();
+        for (int succ : cfg.bbs[node].succs) {
+          // Skip D-edges. The idom of the entry is itself, but a loop of
+          // the entry to itself is a J-edge.
+          if (idoms[succ] == node && succ != node)
+            continue;
+          if (edt.level(succ) > root_level)
+            continue;
+          if (in_idf_gen[succ] == generation)
+            continue;
+          if (live_in && !bset_is_in(*live_in, succ))
+            continue;
+          in_idf_gen[succ] = generation;
+          idf->push(succ);
+          // Definition blocks have already been queued.
+          if (def_gen[succ] != generation) {
+            push(succ);
+          }
+        }
+        LOOP(c, edt.child_offsets[node], edt.child_offsets[node + 1]) {
+          int child = edt.children[c];
+          if (visited_gen[child] != generation) {
+            visited_gen[child] = generation;
+            worklist.push(child);
+          }
+        }
+      }
+    }
+
+    sort_blocks(*idf);
+  }
+
+  void free() {
+    edt.free();
+    idoms.free();
+    bucket_head.free();
+    bucket_next.free();
+    def_gen.free();
+    in_idf_gen.free();
+    visited_gen.free();
+    worklist.free();
+  }
+
+private:
+
+  // Push `bb` in the bucket of its level. Every node is pushed
+  // at most once per computation (either as a definition block or
+  // when it's first found in the IDF).
+  void push(int bb) {
+    int l = edt.level(bb);
+    bucket_next[bb] = bucket_head[l];
+    bucket_head[l] = bb;
+  }
+
+  static
+  int cmp_int(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+  }
+
+  static
+  void sort_blocks(Buf<int> blocks) {
+    // An empty Buf has no data, which qsort() doesn't accept.
+    if (blocks.len() > 1)
+      qsort(blocks.data, blocks.len(), sizeof(int), cmp_int);
+  }
+
+  /// Members ///
+
+  const CFG cfg;
+  ExplicitDomTree edt;
+  Buf<int> idoms;
+  // Piggybank: one intrusive list of nodes per level.
+  Buf<int> bucket_head;
+  Buf<int> bucket_next;
+  // Per-node generation stamps. A node is a definition block, is in the IDF
+  // and was visited in the current computation iff the respective stamp
+  // is equal to `generation`.
+  Buf<int> def_gen;
+  Buf<int> in_idf_gen;
+  Buf<int> visited_gen;
+  int generation;
+  Stack<int> worklist;
+};
+
+// The naive approach: Starting from the definition blocks, union
+// the (materialized) dense DF sets until nothing changes. Used to check and
+// benchmark against the IDFCalculator.
+static
+void idf_naive(const DominanceFrontiers dfronts, const Buf<int> def_blocks,
+               Buf<int> *idf) {
+  int nbbs = dfronts.DF.len();
+  idf->clear();
+  BitSet result = bset(nbbs);
+  BitSet on_worklist = bset(nbbs);
+  Stack<int> worklist;
+  for (int bb : def_blocks) {
+    if (!bset_is_in(on_worklist, bb)) {
+      bset_add(on_worklist, bb);
+      worklist.push(bb);
+    }
+  }
+  while (!worklist.empty()) {
+    int bb = worklist.pop();
+    union_equal_sets_in_place(result, dfronts.DF[bb]);
+    LOOP(n, 0, nbbs) {
+      if (bset_is_in(result, n) && !bset_is_in(on_worklist, n)) {
+        bset_add(on_worklist, n);
+        worklist.push(n);
+      }
+    }
+  }
+  LOOP(n, 0, nbbs) {
+    if (bset_is_in(result, n)) {
+      idf->push(n);
+    }
+  }
+  worklist.free();
+  bset_free(on_worklist);
+  bset_free(result);
+}
+
+#endif
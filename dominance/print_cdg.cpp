@@ -0,0 +1,31 @@
+#include <stdio.h>
+
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "cdg.h"
+
+void print_cdg(ControlDependenceGraph cdg) {
+  LOOP(i, 0, cdg.size()) {
+    printf("%d: ", i);
+    for (const int *x = cdg.controllers_begin(i); x != cdg.controllers_end(i); ++x) {
+      printf("%d ", *x);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  CFG cfg = parse_procedure(argv[1], NULL);
+
+  ControlDependenceGraph cdg = control_dependence_graph(cfg);
+  printf("\n-- Immediate Post-Dominators --\n");
+  LOOP(i, 0, cdg.size()) {
+    printf("%d: %d\n", i, cdg.ipdom(i));
+  }
+  printf("\n\n-- Control Dependences --\n");
+  print_cdg(cdg);
+
+  cdg.free();
+  cfg.destruct();
+}
@@ -22,18 +22,42 @@ void print_dom_fronts(DominanceFrontiers dom_fronts) {
   }
 }
 
+void print_sparse_dom_fronts(SparseDominanceFrontiers dom_fronts) {
+  LOOP(i, 0, dom_fronts.size()) {
+    printf("%d: ", i);
+    for (const int *n = dom_fronts.df_begin(i); n != dom_fronts.df_end(i); ++n) {
+      printf("%d ", *n);
+    }
+    printf("\n");
+  }
+}
+
+// Usage: ./print_dom_fronts [-dense] <file>.ir
+// By default, the sparse DF representation is used.
 int main(int argc, char **argv) {
-  assert(argc == 2);
-  CFG cfg = parse_procedure(argv[1], NULL);
+  assert(argc == 2 || argc == 3);
+  bool dense = false;
+  if (argc == 3) {
+    assert(!strcmp(argv[1], "-dense"));
+    dense = true;
+  }
+  CFG cfg = parse_procedure(argv[argc - 1], NULL);
   DominatorTree dtree(cfg);
 
   printf("\n-- Dominators --\n");
   print_dominators(cfg, dtree);
 
-  DominanceFrontiers dfronts = dom_frontiers(cfg, dtree);
   printf("\n\n-- Dominance Frontiers --\n");
-  print_dom_fronts(dfronts);
+  if (dense) {
+    DominanceFrontiers dfronts = dom_frontiers(cfg, dtree);
+    print_dom_fronts(dfronts);
+    dom_frontiers_free(dfronts);
+  } else {
+    SparseDominanceFrontiers dfronts = sparse_dom_frontiers(cfg, dtree);
+    print_sparse_dom_fronts(dfronts);
+    dfronts.free();
+  }
 
-  dom_frontiers_free(dfronts);
+  dtree.free();
   cfg.destruct();
 }
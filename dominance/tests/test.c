@@ -48,19 +48,37 @@ int main()
             sprintf(buf, "./%.*s.out", namelen - ext_len, entry->d_name);
             if (access(buf, F_OK) == -1) {
                 printf("\t\033[1;31m No .out \033[0m\n");
-                continue;
+            } else {
+                sprintf(buf, "../print_dom_fronts %s/%s > curr_out", dir, entry->d_name);
+                system(buf);
+                sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
+                system(buf);
+                system("rm curr_out");
+                stat("curr_diff", &st);
+                if (st.st_size != 0) {
+                    printf("MISMATCH in %s\n", entry->d_name);
+                    break;
+                } else {
+                    printf("\t\033[1;32m SUCCESS \033[0m\n");
+                    system("rm curr_diff");
+                }
             }
-            sprintf(buf, "../print_dom_fronts %s/%s > curr_out", dir, entry->d_name);
+            // Control dependence graph, if there's a .cdg.out (a procedure
+            // with a single block has no dominators, but it has a CDG)
+            sprintf(buf, "./%.*s.cdg.out", namelen - ext_len, entry->d_name);
+            if (access(buf, F_OK) == -1)
+                continue;
+            sprintf(buf, "../print_cdg %s/%s > curr_out", dir, entry->d_name);
             system(buf);
-            sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
+            sprintf(buf, "diff curr_out ./%.*s.cdg.out > curr_diff", namelen - ext_len, entry->d_name);
             system(buf);
             system("rm curr_out");
             stat("curr_diff", &st);
             if (st.st_size != 0) {
-                printf("MISMATCH in %s\n", entry->d_name);
+                printf("MISMATCH in %s (cdg)\n", entry->d_name);
                 break;
             } else {
-                printf("\t\033[1;32m SUCCESS \033[0m\n");
+                printf("\t\033[1;32m SUCCESS (cdg) \033[0m\n");
                 system("rm curr_diff");
             }
         }
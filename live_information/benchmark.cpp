@@ -0,0 +1,373 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../common/reg_compaction.h"
+#include "../ssa/ssa.h"
+#include "liveout.h"
+#include "live_check.h"
+#include "live_points.h"
+
+/* Benchmark utilities */
+
+static
+void liveout_benchmark_comp(CFG cfg, int nelems, int max_register) {
+ double rr_time_taken, scc_time_taken, wl_time_taken;
+ LiveStats rr_stats, scc_stats, wl_stats;
+ Buf<BitSet> rr, scc, wl;
+ TIME_STMT(rr = liveout_info(cfg, max_register, NULL, &rr_stats), rr_time_taken);
+ TIME_STMT(scc = liveout_info_scc(cfg, max_register, &scc_stats), scc_time_taken);
+ TIME_STMT(wl = liveout_info_worklist(cfg, max_register, &wl_stats), wl_time_taken);
+ LOOP(bb, 0, cfg.size()) {
+   assert(bset_eq(rr[bb], scc[bb]));
+   assert(bset_eq(rr[bb], wl[bb]));
+ }
+
+ printf("Benchmark Round-Robin: %d elements: %.4lfs (%d iterations, %d evaluations, %d transfers)\n",
+        nelems, rr_time_taken, rr_stats.iterations, rr_stats.block_evals,
+        rr_stats.transfers);
+ printf("Benchmark SCC: %d elements: %.4lfs (%d max iterations, %d evaluations, %d transfers)\n",
+        nelems, scc_time_taken, scc_stats.iterations, scc_stats.block_evals,
+        scc_stats.transfers);
+ printf("Benchmark Worklist: %d elements: %.4lfs (%d max iterations, %d evaluations, %d transfers)\n",
+        nelems, wl_time_taken, wl_stats.iterations, wl_stats.block_evals,
+        wl_stats.transfers);
+
+ liveout_free(rr);
+ liveout_free(scc);
+ liveout_free(wl);
+}
+
+static
+void liveout_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 16000, 64000, 256000 };
+ int nregs = 64, ninsts = 4;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   liveout_benchmark_comp(cfg, set[i], nregs - 1);
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// The printing that `print_liveout` does (with stdout sent to /dev/null)
+// against the quiet `liveness()`, which also gives LiveIn.
+static
+void liveness_api_benchmark(void) {
+ int set[] = { 1000, 4000, 16000 };
+ int nregs = 64, ninsts = 4;
+ printf("--- Traced vs Quiet FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = fwdback_cfg(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   double traced_time_taken, quiet_time_taken;
+
+   fflush(stdout);
+   int saved_stdout = dup(STDOUT_FILENO);
+   int devnull = open("/dev/null", O_WRONLY);
+   dup2(devnull, STDOUT_FILENO);
+   Buf<BitSet> LiveOut;
+   TIME_STMT(
+     LiveOut = liveout_info(cfg, nregs - 1, &liveout_print_tracer);
+     fflush(stdout), traced_time_taken);
+   dup2(saved_stdout, STDOUT_FILENO);
+   close(devnull);
+   close(saved_stdout);
+
+   LiveInfo live;
+   TIME_STMT(live = liveness(cfg, nregs - 1), quiet_time_taken);
+   LOOP(bb, 0, cfg.size()) {
+     assert(bset_eq(LiveOut[bb], live.LiveOut[bb]));
+   }
+
+   printf("Benchmark Traced: %d elements: %.4lfs\n", set[i], traced_time_taken);
+   printf("Benchmark Quiet: %d elements: %.4lfs\n", set[i], quiet_time_taken);
+   liveout_free(LiveOut);
+   live.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// One stray register, renamed to %100000, makes all the sets ~12 KB
+// instead of 8 bytes. Liveness before and after compacting the registers.
+static
+void compaction_benchmark(void) {
+ int set[] = { 500, 1000, 2000, 4000 };
+ int nregs = 64, ninsts = 4;
+ uint32_t stray = 100000;
+ printf("--- Sparse vs Compacted Registers FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = fwdback_cfg(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   cfg_map_regs(cfg, [&](uint32_t r) {
+     return (r == (uint32_t) nregs - 1) ? stray : r;
+   });
+   double sparse_time_taken, compact_time_taken;
+
+   LiveInfo sparse;
+   TIME_STMT(sparse = liveness(cfg, stray), sparse_time_taken);
+   RegisterMap map;
+   LiveInfo compact;
+   TIME_STMT(
+     map = compact_registers(cfg);
+     compact = liveness(cfg, map.max_register()), compact_time_taken);
+   LOOP(bb, 0, cfg.size()) {
+     LOOP(r, 0, map.num_registers()) {
+       assert(compact.is_live_out(bb, r) == sparse.is_live_out(bb, map.orig[r]));
+       assert(compact.is_live_in(bb, r) == sparse.is_live_in(bb, map.orig[r]));
+     }
+   }
+
+   size_t sparse_bytes = num_words(sparse.num_registers) * sizeof(BitSet64);
+   size_t compact_bytes = num_words(compact.num_registers) * sizeof(BitSet64);
+   printf("Benchmark Sparse: %d elements: %.4lfs (%zu bytes per set)\n",
+          set[i], sparse_time_taken, sparse_bytes);
+   printf("Benchmark Compacted: %d elements: %.4lfs (%zu bytes per set, %d registers)\n",
+          set[i], compact_time_taken, compact_bytes, map.num_registers());
+   sparse.free();
+   compact.free();
+   map.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// Materializing a set per instruction against `LivePoints`, with a query
+// for every register at every instruction, block after block, in random
+// order (so a block is annotated once per visit).
+static
+void live_points_benchmark(void) {
+ int set[] = { 1000, 4000, 16000 };
+ int nregs = 64, ninsts = 16;
+ printf("--- Program Point Queries FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = fwdback_cfg(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   LiveInfo live = liveness(cfg, nregs - 1);
+   int nbbs = cfg.size();
+   double full_time_taken, query_time_taken;
+
+   Buf<Buf<BitSet>> full;
+   size_t full_bytes = 0;
+   TIME_STMT(
+     full.reserve_and_set(nbbs);
+     full.initialize();
+     LOOP(bb, 0, nbbs) {
+       LOOP(j, 0, (int) cfg.bbs[bb].insts.num_nodes()) {
+         full[bb].push(bset(live.num_registers));
+         full_bytes += num_words(live.num_registers) * sizeof(BitSet64);
+       }
+       live_annotate_block(cfg.bbs[bb], live.LiveOut[bb], full[bb]);
+     }, full_time_taken);
+
+   Buf<int> order;
+   order.reserve_and_set(nbbs);
+   LOOP(bb, 0, nbbs) {
+     order[bb] = bb;
+   }
+   LOOP_REV(k, 1, nbbs) {
+     int r = rand() % (k + 1);
+     int tmp = order[k];
+     order[k] = order[r];
+     order[r] = tmp;
+   }
+   LivePoints points(cfg, &live);
+   int live_count = 0;
+   TIME_STMT(
+     for (int bb : order) {
+       LOOP(j, 0, (int) cfg.bbs[bb].insts.num_nodes()) {
+         LOOP(r, 0, nregs) {
+           live_count += points.is_live_after(bb, j, r);
+         }
+       }
+     }, query_time_taken);
+
+   int expected = 0;
+   LOOP(bb, 0, nbbs) {
+     LOOP(j, 0, full[bb].len()) {
+       LOOP(r, 0, nregs) {
+         expected += bset_is_in(full[bb][j], r);
+       }
+     }
+   }
+   assert(live_count == expected);
+   LOOP(bb, 0, nbbs) {
+     if (full[bb].len()) {
+       assert(bset_eq(full[bb][full[bb].len() - 1], live.LiveOut[bb]));
+     }
+   }
+
+   printf("Benchmark Per-Instruction Sets: %d elements: %.4lfs (%zu bytes)\n",
+          set[i], full_time_taken, full_bytes);
+   printf("Benchmark LivePoints: %d elements: %.4lfs (%zu bytes, %d hits, %d misses)\n",
+          set[i], query_time_taken, points.bytes(), points.hits, points.misses);
+   for (Buf<BitSet> &b : full) {
+     for (BitSet s : b) {
+       bset_free(s);
+     }
+     b.free();
+   }
+   full.free();
+   order.free();
+   points.free();
+   live.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// Breadth-first search from the blocks in `queue` (marked with `stamp` in
+// `seen`) for a use of `reg`, without going through its definition.
+static
+bool search_use(CFG cfg, const SSADefUse &du, int reg, Buf<int> &seen,
+                int stamp, Buf<int> &queue) {
+  int def = du.def_bb[reg];
+  for (int i = 0; i < queue.len(); ++i) {
+    int b = queue[i];
+    for (int u : du.uses[reg]) {
+      if (u == b)
+        return true;
+    }
+    for (int u : du.phi_uses[reg]) {
+      if (u == b)
+        return true;
+    }
+    for (int succ : cfg.bbs[b].succs) {
+      if (succ != def && seen[succ] != stamp) {
+        seen[succ] = stamp;
+        queue.push(succ);
+      }
+    }
+  }
+  return false;
+}
+
+// Reference for the liveness checker: Is there a path from `q` to a use
+// of `reg` that doesn't go through its definition?
+static
+bool live_in_by_search(CFG cfg, const SSADefUse &du, int reg, int q,
+                       Buf<int> &seen, int stamp, Buf<int> &queue) {
+  if (du.def_bb[reg] == q)
+    return false;
+  queue.clear();
+  queue.push(q);
+  seen[q] = stamp;
+  return search_use(cfg, du, reg, seen, stamp, queue);
+}
+
+// Same for live-out: `reg` is a PHI argument from `q` or there's such a
+// path from a successor of `q`.
+static
+bool live_out_by_search(CFG cfg, const SSADefUse &du, int reg, int q,
+                        Buf<int> &seen, int stamp, Buf<int> &queue) {
+  for (int u : du.phi_uses[reg]) {
+    if (u == q)
+      return true;
+  }
+  int def = du.def_bb[reg];
+  queue.clear();
+  for (int succ : cfg.bbs[q].succs) {
+    if (succ != def && seen[succ] != stamp) {
+      seen[succ] = stamp;
+      queue.push(succ);
+    }
+  }
+  return search_use(cfg, du, reg, seen, stamp, queue);
+}
+
+// One-off live-in queries on SSA: the liveness checker against a search
+// per query (live-in and live-out) and, for reference, the full dataflow
+// before SSA.
+static
+void live_check_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 4000, 16000 };
+ int nregs = 64, ninsts = 4, nqueries = 100000, nsearches = 2000;
+ printf("--- Liveness Checker %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   int nbbs = cfg.size();
+   double full_time_taken, pre_time_taken, query_time_taken, search_time_taken;
+
+   LiveInfo live;
+   TIME_STMT(live = liveness(cfg, nregs - 1), full_time_taken);
+   live.free();
+   SSAInfo info = ssa_construct(cfg, nregs - 1, SSA_KIND::PRUNED);
+   int num_registers = info.max_reg + 1;
+
+   SSADefUse *du;
+   LivenessChecker *checker;
+   TIME_STMT(
+     du = new SSADefUse(cfg, info.max_reg);
+     checker = new LivenessChecker(cfg), pre_time_taken);
+
+   Buf<int> regs, bbs;
+   regs.reserve_and_set(nqueries);
+   bbs.reserve_and_set(nqueries);
+   LOOP(k, 0, nqueries) {
+     regs[k] = rand() % num_registers;
+     bbs[k] = rand() % nbbs;
+   }
+   int live_count = 0;
+   TIME_STMT(
+     LOOP(k, 0, nqueries) {
+       live_count += checker->is_live_in(*du, regs[k], bbs[k]);
+     }, query_time_taken);
+
+   Buf<int> seen, queue;
+   seen.reserve_and_set(nbbs);
+   memset(seen.data, 0, nbbs * sizeof(int));
+   int mismatches = 0;
+   TIME_STMT(
+     LOOP(k, 0, nsearches) {
+       bool expected = live_in_by_search(cfg, *du, regs[k], bbs[k], seen,
+                                         2 * k + 1, queue);
+       mismatches += expected != checker->is_live_in(*du, regs[k], bbs[k]);
+       expected = live_out_by_search(cfg, *du, regs[k], bbs[k], seen,
+                                     2 * k + 2, queue);
+       mismatches += expected != checker->is_live_out(*du, regs[k], bbs[k]);
+     }, search_time_taken);
+   assert(!mismatches);
+
+   printf("Benchmark Full Dataflow (before SSA): %d elements: %.4lfs\n", set[i],
+          full_time_taken);
+   printf("Benchmark Checker: %d elements: %.4lfs precomputation, %.4lfs for %d queries (%d live)\n",
+          set[i], pre_time_taken, query_time_taken, nqueries, live_count);
+   printf("Benchmark Search: %d elements: %.4lfs for %d live-in and live-out queries\n",
+          set[i], search_time_taken, nsearches);
+   seen.free();
+   queue.free();
+   regs.free();
+   bbs.free();
+   checker->free();
+   delete checker;
+   du->free();
+   delete du;
+   info.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+int main() {
+  liveout_benchmark("Linear", linear_cfg);
+  liveout_benchmark("FwdBack", fwdback_cfg);
+  liveout_benchmark("ManyPred", manypred_cfg);
+  liveout_benchmark("DeepLoops", deep_loops_cfg);
+  liveout_benchmark("Irreducible", irreducible_cfg);
+  liveness_api_benchmark();
+  compaction_benchmark();
+  live_points_benchmark();
+  live_check_benchmark("FwdBack", fwdback_cfg);
+  live_check_benchmark("DeepLoops", deep_loops_cfg);
+  live_check_benchmark("Irreducible", irreducible_cfg);
+
+  return 0;
+}
@@ -1 +1,2 @@
 g++ print_liveout.cpp -o print_liveout -Wall -Wno-unused-function -ggdb
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
@@ -0,0 +1,397 @@
+#ifndef LIVE_CHECK_H
+#define LIVE_CHECK_H
+
+#include "../common/stefanos.h"
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/traversal.h"
+#include "../dominance/dtree.h"
+
+/*
+Liveness checking for SSA form (Boissinot et al., "Fast Liveness Checking
+for SSA-Form Programs", CGO 2008).
+
+Instead of computing the sets of all the blocks (`liveness()`), we answer
+"is `a` live-in / live-out at block `q`" directly from the definition and
+the uses of `a`. It works because, in (strict) SSA, the definition of `a`
+dominates all its uses. So, `a` is live-in at `q` iff def(a) strictly
+dominates `q` and there's a path from `q` to a use that doesn't go back
+to def(a).
+
+Such a path can be broken into pieces that don't use back edges (of a DFS
+from the entry), connected with back edges. So we precompute, for every
+block `q`:
+- R_q: The blocks reachable from `q` in the reduced graph, i.e. the CFG
+  without the back edges (it's acyclic).
+- Up_q: The targets of the back edges whose source is in R_q, except
+  those that are in R_q already (they don't get us anywhere new).
+
+The back-edge targets that `q` can get to (T_q in the paper) are `q` and,
+transitively, the Up of them. Then `a` is live-in at `q` iff there's a `t`
+in T_q that def(a) strictly dominates and R_t contains a use of `a`. For
+a reducible CFG, T_q is `q` and the headers of the loops that contain `q`.
+We don't store T_q, which for every block can be as big as the loop depth.
+We walk it per query and only follow the targets that def(a) strictly
+dominates (every block of a path that avoids def(a) is), skipping those
+that are dominated by another one (see `reaches_use()`). It's correct for
+irreducible CFGs and for an entry with predecessors too. There's no
+iterative dataflow.
+
+The precomputation (`LivenessChecker`) only depends on the CFG, so it stays
+valid when instructions change, as long as the CFG doesn't. The def-use
+information (`SSADefUse`) is cheap to recompute (or to update).
+
+A PHI argument is a use at the end of the corresponding predecessor, so it
+makes the value live-out (and live-in) there, but not live-in at the block
+of the PHI. A register with no definition (see ssa.h) is considered to be
+defined before the entry, i.e. live-in at the entry if it's used.
+
+The precomputation needs a bitset of blocks per block and, for every block,
+goes over all the back edges, so it's quadratic. Unreachable blocks don't
+have anything live.
+*/
+
+// Def-use information of an SSA CFG, by block.
+typedef struct SSADefUse {
+  // Block that defines every register or -1 if there's no definition.
+  Buf<int> def_bb;
+  // Blocks that use every register (excluding PHIs).
+  Buf<Buf<int>> uses;
+  // Predecessors through which every register reaches a PHI.
+  Buf<Buf<int>> phi_uses;
+
+  SSADefUse(CFG cfg, int max_reg) {
+    int num_registers = max_reg + 1;
+    def_bb.reserve_and_set(num_registers);
+    LOOP(r, 0, num_registers) {
+      def_bb[r] = -1;
+    }
+    uses.reserve_and_set(num_registers);
+    uses.initialize();
+    phi_uses.reserve_and_set(num_registers);
+    phi_uses.initialize();
+
+    // Unreachable blocks are not renamed by `ssa_construct()`, so
+    // they may reuse names.
+    const Buf<int> post_num = cfg_postorder_numbers(cfg);
+    for (BasicBlock &bb : cfg.bbs) {
+      if (post_num[bb.num] == -1)
+        continue;
+      for (Instruction *inst : bb.insts) {
+        switch (inst->kind) {
+        case INST::DEF:
+          def_bb[inst->reg] = bb.num;
+          // Fallthrough
+        case INST::PRINT:
+          add_use(inst->op.lhs, bb.num, uses);
+          if (inst->op.kind == OP_ADD) {
+            add_use(inst->op.rhs, bb.num, uses);
+          }
+          break;
+        case INST::PHI:
+          def_bb[inst->reg] = bb.num;
+          LOOP(j, 0, inst->phi_args.len()) {
+            add_use(inst->phi_args[j], bb.preds[j], phi_uses);
+          }
+          break;
+        case INST::BR_COND:
+          add_use(inst->cond_val, bb.num, uses);
+          break;
+        case INST::BR_UNCOND:
+          break;
+        default:
+          assert(0);
+        }
+      }
+    }
+  }
+
+  void free() {
+    def_bb.free();
+    for (Buf<int> &u : uses) {
+      u.free();
+    }
+    uses.free();
+    for (Buf<int> &u : phi_uses) {
+      u.free();
+    }
+    phi_uses.free();
+  }
+
+private:
+
+  static
+  void add_use(Value v, int bb, Buf<Buf<int>> to) {
+    if (val_kind(v) != VAL_REG)
+      return;
+    Buf<int> &u = to[val_strip_kind(v)];
+    if (!u.len() || u.back() != bb) {
+      u.push(bb);
+    }
+  }
+} SSADefUse;
+
+struct LivenessChecker {
+  LivenessChecker(CFG cfg) : edt(dtree_for(cfg)) {
+    int nbbs = cfg.size();
+    Buf<int> pre_num, post_num;
+    dfs_numbers(cfg, &pre_num, &post_num);
+    const Buf<int> postorder = cfg_postorder(cfg);
+
+    // R, in postorder: all the non-back edges go to blocks that are
+    // already done.
+    size_t base_size = sizeof(BitSet64) * num_words(nbbs);
+    uint8_t *mem = (uint8_t *) calloc(base_size, nbbs);
+    R.reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      R[bb] = bset_mem(nbbs, mem + base_size * bb);
+    }
+    struct BackEdge {
+      int src, dst;
+    };
+    Buf<BackEdge> back_edges;
+    for (int v : postorder) {
+      bset_add(R[v], v);
+      for (int w : cfg.bbs[v].succs) {
+        if (is_ancestor(pre_num, post_num, w, v)) {
+          back_edges.push(BackEdge{v, w});
+        } else {
+          union_equal_sets_in_place(R[v], R[w]);
+        }
+      }
+    }
+
+    // Sort the back edges by the preorder of their target in the dominator
+    // tree (counting sort), so that every Up_x comes out sorted that way.
+    {
+      Buf<int> count;
+      count.reserve_and_set(nbbs + 1);
+      memset(count.data, 0, (nbbs + 1) * sizeof(int));
+      for (BackEdge e : back_edges) {
+        count[edt.pre[e.dst] + 1]++;
+      }
+      LOOP(i, 0, nbbs) {
+        count[i + 1] += count[i];
+      }
+      Buf<BackEdge> sorted;
+      sorted.reserve_and_set(back_edges.len());
+      for (BackEdge e : back_edges) {
+        sorted[count[edt.pre[e.dst]]++] = e;
+      }
+      count.free();
+      back_edges.free();
+      back_edges = sorted;
+    }
+
+    // Up_x, without duplicates. `x` comes back to itself if it's the
+    // target of a back edge whose source is in R_x.
+    up_offsets.reserve_and_set(nbbs + 1);
+    reenters.reserve_and_set(nbbs);
+    up_offsets[0] = 0;
+    Buf<int> mark;
+    mark.reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      mark[bb] = -1;
+    }
+    LOOP(x, 0, nbbs) {
+      reenters[x] = false;
+      for (BackEdge e : back_edges) {
+        if (!bset_is_in(R[x], e.src))
+          continue;
+        if (e.dst == x) {
+          reenters[x] = true;
+        } else if (mark[e.dst] != x && !bset_is_in(R[x], e.dst)) {
+          mark[e.dst] = x;
+          up.push(e.dst);
+        }
+      }
+      up_offsets[x + 1] = up.len();
+    }
+
+    stamp.reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      stamp[bb] = 0;
+    }
+    generation = 0;
+    mark.free();
+    back_edges.free();
+    pre_num.free();
+    post_num.free();
+  }
+
+  bool is_live_in(const SSADefUse &du, int reg, int q) const {
+    int def = du.def_bb[reg];
+    if (!edt.is_reachable_from_entry(q) || def == q)
+      return false;
+    return reaches_use(du, reg, q, false);
+  }
+
+  bool is_live_out(const SSADefUse &du, int reg, int q) const {
+    if (!edt.is_reachable_from_entry(q))
+      return false;
+    for (int p : du.phi_uses[reg]) {
+      if (p == q)
+        return true;
+    }
+    int def = du.def_bb[reg];
+    if (def == q) {
+      // Any use in another block is reached from here.
+      for (int u : du.uses[reg]) {
+        if (u != q)
+          return true;
+      }
+      return du.phi_uses[reg].len() != 0;
+    }
+    return reaches_use(du, reg, q, true);
+  }
+
+  const int *up_begin(int x) const {
+    return &up.data[up_offsets[x]];
+  }
+
+  const int *up_end(int x) const {
+    return &up.data[up_offsets[x + 1]];
+  }
+
+  void free() {
+    if (R.len())
+      bset_free(R[0]);
+    R.free();
+    up_offsets.free();
+    up.free();
+    reenters.free();
+    walk.free();
+    stamp.free();
+    edt.free();
+  }
+
+private:
+
+  static
+  ExplicitDomTree dtree_for(CFG cfg) {
+    DominatorTree dtree(cfg);
+    ExplicitDomTree res(dtree);
+    dtree.free();
+    return res;
+  }
+
+  // Preorder and postorder numbers of a DFS from the entry (-1 if
+  // unreachable).
+  static
+  void dfs_numbers(CFG cfg, Buf<int> *pre_num, Buf<int> *post_num) {
+    int nbbs = cfg.size();
+    Buf<int> pre, post;
+    Traversal t;
+    t.dfs(cfg, 0, DIR::FORWARD, &pre, &post);
+    t.free();
+    pre_num->reserve_and_set(nbbs);
+    post_num->reserve_and_set(nbbs);
+    LOOP(bb, 0, nbbs) {
+      (*pre_num)[bb] = (*post_num)[bb] = -1;
+    }
+    LOOP(i, 0, pre.len()) {
+      (*pre_num)[pre[i]] = i;
+      (*post_num)[post[i]] = i;
+    }
+    pre.free();
+    post.free();
+  }
+
+  static
+  bool is_ancestor(const Buf<int> pre_num, const Buf<int> post_num,
+                   int a, int b) {
+    return pre_num[a] <= pre_num[b] && post_num[b] <= post_num[a];
+  }
+
+  // Does R_t contain a use of `reg`? Uses in `skip` don't count.
+  static
+  bool R_has_use(BitSet Rt, const SSADefUse &du, int reg, int skip) {
+    for (int u : du.uses[reg]) {
+      if (u != skip && bset_is_in(Rt, u))
+        return true;
+    }
+    for (int u : du.phi_uses[reg]) {
+      if (u != skip && bset_is_in(Rt, u))
+        return true;
+    }
+    return false;
+  }
+
+  // The first target in Up_x whose preorder (in the dominator tree)
+  // is larger than `key`.
+  const int *up_after(int x, int key) const {
+    const int *lo = up_begin(x), *hi = up_end(x);
+    while (lo < hi) {
+      const int *mid = lo + (hi - lo) / 2;
+      if (edt.pre[*mid] <= key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // Is there a `t` in T_q, strictly dominated by the definition of `reg`,
+  // from which a use is reachable in the reduced graph? For live-out, a
+  // use in `q` itself counts only if we come back to `q`.
+  //
+  // If `a` dominates `b`, then `a` is an ancestor of `b` in any DFS, so R_b
+  // is a subset of R_a and Up_b is a subset of Up_a plus blocks in R_a. So,
+  // from every Up list, we only take the targets that are not dominated by
+  // another target that we took. Since the lists are sorted in the preorder
+  // of the dominator tree, we skip the ones dominated by `n` by jumping
+  // past last(n). The targets that def(a) strictly dominates are an
+  // interval too. For a reducible CFG, we take a single target per list.
+  bool reaches_use(const SSADefUse &du, int reg, int q, bool out) const {
+    int def = du.def_bb[reg];
+    if (def != -1 && !edt.strictly_dominates(def, q))
+      return false;
+    // The interval of preorder numbers of the blocks that `def` strictly
+    // dominates (all of them if there's no definition).
+    int lo = (def == -1) ? 0 : edt.pre[def] + 1;
+    int hi = (def == -1) ? INT_MAX : edt.last[def];
+    ++generation;
+    walk.clear();
+    walk.push(q);
+    stamp[q] = generation;
+    bool came_back = out && reenters[q];
+    for (int i = 0; i < walk.len(); ++i) {
+      int t = walk[i];
+      int skip = (out && t == q && !came_back) ? q : -1;
+      if (R_has_use(R[t], du, reg, skip))
+        return true;
+      const int *end = up_end(t);
+      for (const int *n = up_after(t, lo - 1); n != end && edt.pre[*n] <= hi;
+           n = up_after(t, edt.last[*n])) {
+        if (*n == q && out && !came_back) {
+          came_back = true;
+          if (R_has_use(R[q], du, reg, -1))
+            return true;
+        }
+        if (stamp[*n] != generation) {
+          stamp[*n] = generation;
+          walk.push(*n);
+        }
+      }
+    }
+    return false;
+  }
+
+  /// Members ///
+
+  ExplicitDomTree edt;
+  // Reduced reachability of every block (nbbs elements each).
+  Buf<BitSet> R;
+  // CSR: Up_x is up[up_offsets[x] .. up_offsets[x + 1]).
+  Buf<int> up_offsets;
+  Buf<int> up;
+  Buf<bool> reenters;
+  // Scratch space of the queries (the walk over T_q).
+  mutable Buf<int> walk;
+  mutable Buf<int> stamp;
+  mutable int generation;
+};
+
+#endif
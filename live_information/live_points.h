@@ -0,0 +1,224 @@
+#ifndef LIVE_POINTS_H
+#define LIVE_POINTS_H
+
+#include "../common/stefanos.h"
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "liveout.h"
+
+/*
+Liveness at program points, i.e. "is %r live right after instruction I".
+
+`liveness()` only gives LiveIn / LiveOut per block. Storing a set per
+instruction would multiply the memory by the number of instructions, so
+instead we derive them on demand: the registers live after the last
+instruction are the LiveOut of the block and, going backwards,
+
+  live_before(I) = uses(I) U (live_after(I) - defs(I))
+
+`live_annotate_block()` is the batch mode: It gives the live-after set of
+every instruction of a block with one backward pass. `LivePoints` answers
+single queries. It annotates the block of the query and caches the
+annotation, keeping the last `capacity` blocks queried (LRU). So, queries
+that go over a block (e.g. a spilling decision for every instruction)
+pay one backward pass, and the memory is bounded by the largest blocks.
+
+A program point is identified by its block and the position of the
+instruction in the block (0 is the first one). Like `liveness()`, this
+doesn't handle PHIs.
+*/
+
+// Step backwards over `inst`: `live` goes from live-after to live-before.
+static
+void live_step_back(const Instruction *inst, BitSet live) {
+  switch (inst->kind) {
+  case INST::DEF:
+    bset_remove(live, inst->reg);
+    // Fallthrough
+  case INST::PRINT:
+    if (val_kind(inst->op.lhs) == VAL_REG) {
+      bset_add(live, val_strip_kind(inst->op.lhs));
+    }
+    if (inst->op.kind == OP_ADD && val_kind(inst->op.rhs) == VAL_REG) {
+      bset_add(live, val_strip_kind(inst->op.rhs));
+    }
+    break;
+  case INST::BR_COND:
+    if (val_kind(inst->cond_val) == VAL_REG) {
+      bset_add(live, val_strip_kind(inst->cond_val));
+    }
+    break;
+  case INST::BR_UNCOND:
+    break;
+  default:
+    assert(0);
+  }
+}
+
+// Batch mode: `out[i]` becomes the set of registers live right after the
+// i-th instruction of `bb`. `out` must have a set for every instruction.
+static
+void live_annotate_block(const BasicBlock &bb, BitSet LiveOut, Buf<BitSet> out) {
+  assert(out.len() >= (ssize_t) bb.insts.num_nodes());
+  int i = bb.insts.num_nodes() - 1;
+  if (i < 0)
+    return;
+  bset_copy(out[i], LiveOut);
+  for (auto *n = bb.insts.tail; i > 0; n = n->prev, --i) {
+    bset_copy(out[i - 1], out[i]);
+    live_step_back((const Instruction *) n, out[i - 1]);
+  }
+}
+
+struct LivePoints {
+  // `live` must be for `cfg`. It's not copied, so keep it around.
+  LivePoints(CFG _cfg, const LiveInfo *_live, int _capacity = 16)
+    : cfg(_cfg), live(_live), capacity(_capacity) {
+    assert(capacity > 0);
+    hits = misses = 0;
+    tick = 0;
+    slot_of.reserve_and_set(cfg.size());
+    LOOP(bb, 0, cfg.size()) {
+      slot_of[bb] = -1;
+    }
+  }
+
+  // Is `reg` live right after the `idx`-th instruction of `bb`?
+  bool is_live_after(int bb, int idx, int reg) {
+    return bset_is_in(annotation(bb)[idx], reg);
+  }
+
+  // Is `reg` live right before the `idx`-th instruction of `bb`?
+  bool is_live_before(int bb, int idx, int reg) {
+    if (idx == 0)
+      return live->is_live_in(bb, reg);
+    return is_live_after(bb, idx - 1, reg);
+  }
+
+  // Same, but finds the position of `inst` in its block, which is O(position).
+  bool is_live_after(const Instruction *inst, int reg) {
+    return is_live_after(inst->parent->num, position(inst), reg);
+  }
+
+  bool is_live_before(const Instruction *inst, int reg) {
+    return is_live_before(inst->parent->num, position(inst), reg);
+  }
+
+  // The live-after sets of all the instructions of `bb`. They are
+  // owned by the cache and valid until the next query.
+  const Buf<BitSet> annotation(int bb) {
+    int s = slot_of[bb];
+    if (s != -1) {
+      ++hits;
+      slots[s].last_used = ++tick;
+      return slots[s].sets;
+    }
+    ++misses;
+    s = victim();
+    Slot &slot = slots[s];
+    if (slot.bb != -1) {
+      slot_of[slot.bb] = -1;
+    }
+    slot.bb = bb;
+    slot.last_used = ++tick;
+    slot_of[bb] = s;
+    fill(slot, cfg.bbs[bb]);
+    return slot.sets;
+  }
+
+  // Memory taken by the cached sets.
+  size_t bytes() const {
+    size_t res = 0;
+    for (const Slot &slot : slots) {
+      res += slot.cap * num_words(live->num_registers) * sizeof(BitSet64);
+    }
+    return res;
+  }
+
+  void free() {
+    for (Slot &slot : slots) {
+      slot.free();
+    }
+    slots.free();
+    slot_of.free();
+  }
+
+  // Queries answered from the cache and queries that annotated a block.
+  int hits, misses;
+
+private:
+
+  struct Slot {
+    int bb;
+    int last_used;
+    // One set per instruction, from a single allocation of
+    // `cap` sets.
+    Buf<BitSet> sets;
+    int cap;
+
+    void free() {
+      if (cap)
+        bset_free(sets[0]);
+      sets.free();
+    }
+  };
+
+  static
+  int position(const Instruction *inst) {
+    int idx = 0;
+    for (auto *n = inst->prev; n; n = n->prev) {
+      ++idx;
+    }
+    return idx;
+  }
+
+  // A free slot or the least recently used one.
+  int victim() {
+    if (slots.len() < capacity) {
+      Slot slot;
+      slot.bb = -1;
+      slot.last_used = 0;
+      slot.cap = 0;
+      slots.push(slot);
+      return slots.len() - 1;
+    }
+    int lru = 0;
+    LOOP(s, 1, slots.len()) {
+      if (slots[s].last_used < slots[lru].last_used) {
+        lru = s;
+      }
+    }
+    return lru;
+  }
+
+  void fill(Slot &slot, const BasicBlock &bb) {
+    int ninsts = bb.insts.num_nodes();
+    int num_registers = live->num_registers;
+    if (slot.cap < ninsts) {
+      slot.free();
+      slot.cap = ninsts;
+      size_t base_size = sizeof(BitSet64) * num_words(num_registers);
+      uint8_t *mem = (uint8_t *) calloc(base_size, ninsts);
+      slot.sets.reserve_and_set(ninsts);
+      LOOP(i, 0, ninsts) {
+        slot.sets[i] = bset_mem(num_registers, mem);
+        mem += base_size;
+      }
+    }
+    slot.sets.resize(ninsts);
+    live_annotate_block(bb, live->LiveOut[bb.num], slot.sets);
+  }
+
+  /// Members ///
+
+  CFG cfg;
+  const LiveInfo *live;
+  int capacity;
+  int tick;
+  Buf<Slot> slots;
+  // Slot of every block or -1
+  Buf<int> slot_of;
+};
+
+#endif
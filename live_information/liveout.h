@@ -5,7 +5,8 @@
 #include "../common/bitset.h"
 #include "../common/cfg.h"
 #include "../common/parser_ir.h"
-#include "../common/utils.h"
+#include "../common/scc.h"
+#include "../common/traversal.h"
 
 typedef struct LiveInitialInfo {
   Buf<BitSet> UEVar;
@@ -22,15 +23,65 @@ void add_if_not_in_VarKill(Value v, BitSet UEVar, BitSet VarKill) {
   }
 }
 
+// Registers are printed as `reg_names[i]`, if not NULL.
 static
-void print_bitset(BitSet s) {
+void print_bitset(BitSet s, const uint32_t *reg_names = NULL) {
   for (int i = 0; i < s.max_elems; ++i) {
     if (bset_is_in(s, i))
-      printf("%d ", i);
+      printf("%u ", reg_names ? reg_names[i] : (uint32_t) i);
   }
   printf("\n");
 }
 
+/*
+Tracing hook. The solvers don't print anything; if you want to see what
+they do, pass a LiveTracer. Any of the callbacks can be NULL. `ctx` is
+passed to all of them as is.
+*/
+typedef struct LiveTracer {
+  void *ctx;
+  // Called for every block, after its UEVar and VarKill are computed.
+  void (*initial_info)(void *ctx, BasicBlock bb, BitSet UEVar, BitSet VarKill);
+  // Called after every pass of `liveout_info()`, with the LiveOut
+  // of all the `nbbs` blocks.
+  void (*after_iteration)(void *ctx, int iteration, const Buf<BitSet> LiveOut,
+                          int nbbs);
+} LiveTracer;
+
+// For the printing tracer, `ctx` is the name of every register
+// (`const uint32_t *`, see reg_compaction.h) or NULL.
+static
+void liveout_print_initial_info(void *ctx, BasicBlock bb, BitSet UEVar,
+                                BitSet VarKill) {
+  const uint32_t *reg_names = (const uint32_t *) ctx;
+  printf("-----------------\n");
+  bb.print(reg_names);
+  printf("-----------------\n");
+  printf("\n");
+  printf("\tUEVar: ");
+  print_bitset(UEVar, reg_names);
+  printf("\tVarKill: ");
+  print_bitset(VarKill, reg_names);
+  printf("\n");
+}
+
+static
+void liveout_print_iteration(void *ctx, int iteration,
+                             const Buf<BitSet> LiveOut, int nbbs) {
+  printf("After iteration %d\n", iteration);
+  LOOP(i, 0, nbbs) {
+    printf("BB%u: ", i);
+    print_bitset(LiveOut[i], (const uint32_t *) ctx);
+  }
+}
+
+// Prints everything to stdout (see print_liveout.cpp).
+static const LiveTracer liveout_print_tracer = {
+  .ctx = NULL,
+  .initial_info = liveout_print_initial_info,
+  .after_iteration = liveout_print_iteration,
+};
+
 // Assume bitsets are allocated and initialized to 0
 static
 void gather_info_for_block(const BasicBlock bb, BitSet UEVar, BitSet VarKill) {
@@ -64,36 +115,33 @@ void gather_info_for_block(const BasicBlock bb, BitSet UEVar, BitSet VarKill) {
   }
 }
 
+// UEVar and VarKill are sets of registers, so they have
+// `num_registers` elements.
 static
-LiveInitialInfo liveout_gather_initial_info(CFG cfg) {
+LiveInitialInfo liveout_gather_initial_info(CFG cfg, int num_registers,
+                                            const LiveTracer *tracer = NULL) {
   LiveInitialInfo res;
   uint32_t nbbs = cfg.size();
   res.UEVar.reserve_and_set(nbbs);
   res.VarKill.reserve_and_set(nbbs);
 
-  size_t base_size = sizeof(BitSet64) * num_words(nbbs);
+  size_t base_size = sizeof(BitSet64) * num_words(num_registers);
   uint8_t *mem = (uint8_t *) calloc(base_size, 2*nbbs);
   uint8_t *p1 = mem;
   uint8_t *p2 = mem + base_size*nbbs;
   LOOPu32(i, 0, nbbs) {
-    res.UEVar[i] = bset_mem(nbbs, p1);
-    res.VarKill[i] = bset_mem(nbbs, p2);
+    res.UEVar[i] = bset_mem(num_registers, p1);
+    res.VarKill[i] = bset_mem(num_registers, p2);
     p1 += base_size;
     p2 += base_size;
   }
 
   int i = 0;
   for (BasicBlock bb : cfg.bbs) {
-    printf("-----------------\n");
-    bb.print();
-    printf("-----------------\n");
-    printf("\n");
     gather_info_for_block(bb, res.UEVar[i], res.VarKill[i]);
-    printf("\tUEVar: ");
-    print_bitset(res.UEVar[i]);
-    printf("\tVarKill: ");
-    print_bitset(res.VarKill[i]);
-    printf("\n");
+    if (tracer && tracer->initial_info) {
+      tracer->initial_info(tracer->ctx, bb, res.UEVar[i], res.VarKill[i]);
+    }
     ++i;
   }
   return res;
@@ -119,61 +167,296 @@ void liveout_solve_equ_for_bb(Buf<BitSet> LiveOut, LiveInitialInfo init_info,
   }
 }
 
-static
-Buf<BitSet> liveout_info(CFG cfg, int max_register) {
-  // Get initial info
-  LiveInitialInfo init_info = liveout_gather_initial_info(cfg);
-
-  // Get postorder
-  Buf<int> postorder = postorder_dfs(cfg);
-
-  // Allocate memory for the bitsets
-  int num_registers = max_register + 1;
-  int nbbs = cfg.size();
+typedef struct LiveStats {
+  // Passes over the blocks (for the SCC solver, the max over
+  // the components; for the worklist solver, the max times
+  // a block was taken from the worklist).
+  int iterations;
+  // Number of times the equation of a block was solved.
+  int block_evals;
+  // Number of times the transfer function, i.e.
+  // UEVar U (LiveOut - VarKill), was applied.
+  int transfers;
+} LiveStats;
 
+// LiveOut sets for `nbbs` blocks plus 2 temps, from a single allocation.
+static
+Buf<BitSet> liveout_alloc(int nbbs, int num_registers) {
   size_t base_size = sizeof(BitSet64) * num_words(num_registers);
-  // +2 for the temps
   uint8_t *mem = (uint8_t *) calloc(base_size, nbbs + 2);
   Buf<BitSet> LiveOut;
   LiveOut.reserve_and_set(nbbs + 2);
-  LOOP(i, 0, nbbs) {
+  LOOP(i, 0, nbbs + 2) {
     LiveOut[i] = bset_mem(num_registers, mem);
     mem += base_size;
   }
-  BitSet temp1 = bset_mem(num_registers, mem);
-  BitSet temp2 = bset_mem(num_registers, mem + base_size);
+  return LiveOut;
+}
+
+static
+void liveout_free(Buf<BitSet> LiveOut) {
+  bset_free(LiveOut[0]);
+  LiveOut.free();
+}
+
+// Round-robin in postorder until nothing changes.
+static
+Buf<BitSet> liveout_info(CFG cfg, int max_register,
+                         const LiveTracer *tracer = NULL,
+                         LiveStats *stats = NULL) {
+  int num_registers = max_register + 1;
+  int nbbs = cfg.size();
+
+  // Get initial info
+  LiveInitialInfo init_info = liveout_gather_initial_info(cfg, num_registers,
+                                                          tracer);
+
+  // Get postorder (cached on the CFG)
+  const Buf<int> postorder = cfg_postorder(cfg);
+
+  Buf<BitSet> LiveOut = liveout_alloc(nbbs, num_registers);
+  BitSet temp1 = LiveOut[nbbs];
+  BitSet temp2 = LiveOut[nbbs + 1];
 
   // Main fixed-point loop.
   int changed = 0;
   int iteration = 1;
+  int transfers = 0;
   do {
     changed = 0;
     for (int i : postorder) {
       BasicBlock bb = cfg.bbs[i];
       bset_copy(temp1, LiveOut[i]);
       liveout_solve_equ_for_bb(LiveOut, init_info, temp2, i, bb.succs);
+      transfers += bb.succs.len();
       if (!bset_eq(temp1, LiveOut[i])) {
         changed = 1;
       }
     }
-    printf("After iteration %d\n", iteration);
-    LOOPu32(i, 0, cfg.size()) {
-      printf("BB%u: ", i);
-      print_bitset(LiveOut[i]);
+    if (tracer && tracer->after_iteration) {
+      tracer->after_iteration(tracer->ctx, iteration, LiveOut, nbbs);
     }
     ++iteration;
   } while (changed);
 
+  if (stats) {
+    stats->iterations = iteration - 1;
+    stats->block_evals = (iteration - 1) * postorder.len();
+    stats->transfers = transfers;
+  }
   liveout_free_initial_info(init_info);
-  postorder.free();
 
   return LiveOut;
 }
 
+/*
+SCC-ordered LiveOut: Liveness is a backward problem, so the LiveOut of a block
+only depends on blocks in its own SCC or in SCCs that come after it in
+topological order. So, we visit the SCCs in reverse topological order
+(sinks first, which is the order `cfg_sccs()` numbers them) and we solve
+each to a fixpoint before moving on. An acyclic SCC (a single block
+without a self-loop) needs a single evaluation, since its successors are
+final. In a cyclic one, the blocks are visited in postorder.
+
+The result is the same as `liveout_info()`. Blocks that are not reachable
+from the entry are skipped, as there.
+*/
 static
-void liveout_free(Buf<BitSet> LiveOut) {
-  bset_free(LiveOut[0]);
-  LiveOut.free();
+Buf<BitSet> liveout_info_scc(CFG cfg, int max_register,
+                             LiveStats *stats = NULL) {
+  int num_registers = max_register + 1;
+  int nbbs = cfg.size();
+  LiveInitialInfo init_info = liveout_gather_initial_info(cfg, num_registers);
+  const Buf<int> post_num = cfg_postorder_numbers(cfg);
+  SCCs sccs = cfg_sccs(cfg);
+  sccs.order_members_by(cfg_postorder(cfg));
+
+  Buf<BitSet> LiveOut = liveout_alloc(nbbs, num_registers);
+  BitSet temp1 = LiveOut[nbbs];
+  BitSet temp2 = LiveOut[nbbs + 1];
+
+  int max_passes = 0;
+  int block_evals = 0;
+  int transfers = 0;
+  LOOP(c, 0, sccs.size()) {
+    const int *begin = sccs.members_begin(c);
+    const int *end = sccs.members_end(c);
+    // Either all the blocks of an SCC are reachable or none is.
+    if (post_num[*begin] == -1)
+      continue;
+    if (!sccs.is_cyclic(c)) {
+      liveout_solve_equ_for_bb(LiveOut, init_info, temp2, *begin,
+                               cfg.bbs[*begin].succs);
+      ++block_evals;
+      transfers += cfg.bbs[*begin].succs.len();
+      max_passes = MAX(max_passes, 1);
+      continue;
+    }
+    int changed;
+    int passes = 0;
+    do {
+      changed = 0;
+      for (const int *bb = begin; bb != end; ++bb) {
+        bset_copy(temp1, LiveOut[*bb]);
+        liveout_solve_equ_for_bb(LiveOut, init_info, temp2, *bb,
+                                 cfg.bbs[*bb].succs);
+        ++block_evals;
+        transfers += cfg.bbs[*bb].succs.len();
+        if (!bset_eq(temp1, LiveOut[*bb])) {
+          changed = 1;
+        }
+      }
+      ++passes;
+    } while (changed);
+    max_passes = MAX(max_passes, passes);
+  }
+
+  if (stats) {
+    stats->iterations = max_passes;
+    stats->block_evals = block_evals;
+    stats->transfers = transfers;
+  }
+  sccs.free();
+  liveout_free_initial_info(init_info);
+  return LiveOut;
+}
+
+/*
+Worklist LiveOut: The solvers above recompute LiveOut(b) from the LiveIn of
+every successor, i.e. they apply the transfer function once per edge,
+and they revisit blocks whose successors didn't change.
+
+Here, LiveIn(b) = UEVar(b) U (LiveOut(b) - VarKill(b)) is cached per block,
+so LiveOut(b) is just the union of the LiveIn of the successors and the
+transfer function is applied once per evaluation. A block is (re)evaluated
+only if the LiveIn of a successor changed: when LiveIn(b) changes, the
+predecessors of `b` are pushed, unless they are already in the worklist
+(a bitset flag). The worklist is a FIFO queue that starts with the blocks in
+postorder, so on an acyclic CFG every block is evaluated once.
+
+The result is the same as `liveout_info()`. Blocks that are not reachable
+from the entry are skipped, as there.
+*/
+static
+void liveout_worklist_solve(CFG cfg, LiveInitialInfo init_info,
+                            Buf<BitSet> LiveOut, Buf<BitSet> LiveIn,
+                            LiveStats *stats) {
+  int nbbs = cfg.size();
+  const Buf<int> postorder = cfg_postorder(cfg);
+  const Buf<int> post_num = cfg_postorder_numbers(cfg);
+  BitSet temp = LiveOut[nbbs];
+  for (int b : postorder) {
+    bset_copy(LiveIn[b], init_info.UEVar[b]);
+  }
+
+  // Circular FIFO. Every block is in it at most once, so `nbbs` slots
+  // are enough.
+  Buf<int> queue;
+  queue.reserve_and_set(nbbs);
+  BitSet in_worklist = bset(nbbs);
+  int head = 0, count = 0;
+  for (int b : postorder) {
+    queue[count++] = b;
+    bset_add(in_worklist, b);
+  }
+
+  Buf<int> evals;
+  evals.reserve_and_set(nbbs);
+  memset(evals.data, 0, nbbs * sizeof(int));
+  int block_evals = 0;
+  while (count) {
+    int b = queue[head];
+    head = (head + 1) % nbbs;
+    --count;
+    bset_remove(in_worklist, b);
+    ++evals[b];
+    ++block_evals;
+
+    BitSet out = LiveOut[b];
+    bset_clear(out);
+    for (int succ : cfg.bbs[b].succs) {
+      union_equal_sets_in_place(out, LiveIn[succ]);
+    }
+    bset_copy(temp, init_info.VarKill[b]);
+    bset_not(temp);
+    intersect_equal_sets_in_place(temp, out);
+    union_equal_sets_in_place(temp, init_info.UEVar[b]);
+    if (bset_eq(temp, LiveIn[b]))
+      continue;
+    bset_copy(LiveIn[b], temp);
+    for (int pred : cfg.bbs[b].preds) {
+      if (post_num[pred] != -1 && !bset_is_in(in_worklist, pred)) {
+        bset_add(in_worklist, pred);
+        queue[(head + count) % nbbs] = pred;
+        ++count;
+      }
+    }
+  }
+
+  if (stats) {
+    stats->iterations = 0;
+    LOOP(b, 0, nbbs) {
+      stats->iterations = MAX(stats->iterations, evals[b]);
+    }
+    stats->block_evals = block_evals;
+    stats->transfers = block_evals;
+  }
+  evals.free();
+  bset_free(in_worklist);
+  queue.free();
+}
+
+static
+Buf<BitSet> liveout_info_worklist(CFG cfg, int max_register,
+                                  LiveStats *stats = NULL) {
+  int num_registers = max_register + 1;
+  int nbbs = cfg.size();
+  LiveInitialInfo init_info = liveout_gather_initial_info(cfg, num_registers);
+  Buf<BitSet> LiveOut = liveout_alloc(nbbs, num_registers);
+  Buf<BitSet> LiveIn = liveout_alloc(nbbs, num_registers);
+  liveout_worklist_solve(cfg, init_info, LiveOut, LiveIn, stats);
+  liveout_free(LiveIn);
+  liveout_free_initial_info(init_info);
+  return LiveOut;
+}
+
+/*
+The library API: LiveIn and LiveOut of every block, with the worklist
+solver. Nothing is printed. All the sets have `num_registers` elements
+(i.e. max_register + 1). Blocks that are not reachable from the entry
+have empty sets.
+*/
+typedef struct LiveInfo {
+  int num_registers;
+  Buf<BitSet> LiveIn;
+  Buf<BitSet> LiveOut;
+
+  bool is_live_in(int bb, int reg) const {
+    return bset_is_in(LiveIn[bb], reg);
+  }
+
+  bool is_live_out(int bb, int reg) const {
+    return bset_is_in(LiveOut[bb], reg);
+  }
+
+  void free() {
+    liveout_free(LiveIn);
+    liveout_free(LiveOut);
+  }
+} LiveInfo;
+
+static
+LiveInfo liveness(CFG cfg, int max_register, LiveStats *stats = NULL) {
+  LiveInfo info;
+  info.num_registers = max_register + 1;
+  int nbbs = cfg.size();
+  LiveInitialInfo init_info = liveout_gather_initial_info(cfg,
+                                                          info.num_registers);
+  info.LiveOut = liveout_alloc(nbbs, info.num_registers);
+  info.LiveIn = liveout_alloc(nbbs, info.num_registers);
+  liveout_worklist_solve(cfg, init_info, info.LiveOut, info.LiveIn, stats);
+  liveout_free_initial_info(init_info);
+  return info;
 }
 
 #endif
@@ -3,15 +3,104 @@
 #include "../common/bitset.h"
 #include "../common/cfg.h"
 #include "../common/parser_ir.h"
+#include "../common/reg_compaction.h"
+#include "../ssa/ssa.h"
 #include "liveout.h"
+#include "live_check.h"
+#include "live_points.h"
 
+// Print every block with the registers live right after each instruction.
+static
+void print_live_points(CFG cfg, int max_register) {
+  LiveInfo live = liveness(cfg, max_register);
+  Buf<BitSet> after;
+  for (BasicBlock &bb : cfg.bbs) {
+    int ninsts = bb.insts.num_nodes();
+    after.clear();
+    LOOP(i, 0, ninsts) {
+      after.push(bset(live.num_registers));
+    }
+    live_annotate_block(bb, live.LiveOut[bb.num], after);
+    printf(".%d:\t\t;; live-in: ", bb.num);
+    print_bitset(live.LiveIn[bb.num]);
+    int i = 0;
+    for (Instruction *inst : bb.insts) {
+      inst->print_out();
+      printf("\t;; live: ");
+      print_bitset(after[i++]);
+    }
+    printf("\n");
+    for (BitSet s : after) {
+      bset_free(s);
+    }
+  }
+  after.free();
+  live.free();
+}
+
+// Convert to (pruned) SSA and print LiveIn / LiveOut of every block
+// with the liveness checker.
+static
+void print_live_check(CFG cfg, int max_register) {
+  SSAInfo info = ssa_construct(cfg, max_register, SSA_KIND::PRUNED);
+  cfg.print();
+  SSADefUse du(cfg, info.max_reg);
+  LivenessChecker checker(cfg);
+  LOOP(bb, 0, cfg.size()) {
+    printf("BB%d: in: ", bb);
+    LOOP(r, 0, info.max_reg + 1) {
+      if (checker.is_live_in(du, r, bb))
+        printf("%d ", r);
+    }
+    printf("-- out: ");
+    LOOP(r, 0, info.max_reg + 1) {
+      if (checker.is_live_out(du, r, bb))
+        printf("%d ", r);
+    }
+    printf("\n");
+  }
+  checker.free();
+  du.free();
+  info.free();
+}
+
+// Usage: print_liveout [-compact | -points | -check] file
+// With -compact, the registers are compacted to a dense range before
+// the analysis, so the sets are as small as possible. The output is
+// printed with the original names, so it's the same either way.
+// With -points, it prints the registers live after every instruction.
+// With -check, it converts to SSA and uses the liveness checker.
 int main(int argc, char **argv) {
-  assert(argc == 2);
+  assert(argc == 2 || argc == 3);
+  bool compact = false, points = false, check = false;
+  if (argc == 3) {
+    if (!strcmp(argv[1], "-points")) {
+      points = true;
+    } else if (!strcmp(argv[1], "-check")) {
+      check = true;
+    } else {
+      assert(!strcmp(argv[1], "-compact"));
+      compact = true;
+    }
+  }
   int max_register;
-  CFG cfg = parse_procedure(argv[1], &max_register);
-  if (cfg.size()) {
-    Buf<BitSet> LiveOut = liveout_info(cfg, max_register);
+  CFG cfg = parse_procedure(argv[argc - 1], &max_register);
+  if (points) {
+    print_live_points(cfg, max_register);
+  } else if (check) {
+    if (cfg.size())
+      print_live_check(cfg, max_register);
+  } else if (cfg.size()) {
+    LiveTracer tracer = liveout_print_tracer;
+    RegisterMap map;
+    if (compact) {
+      map = compact_registers(cfg);
+      max_register = map.max_register();
+      tracer.ctx = map.orig.data;
+    }
+    Buf<BitSet> LiveOut = liveout_info(cfg, max_register, &tracer);
     liveout_free(LiveOut);
+    map.free();
   }
 
   cfg.destruct();
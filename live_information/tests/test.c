@@ -63,6 +63,54 @@ int main()
                 printf("\t\033[1;32m SUCCESS \033[0m\n");
                 system("rm curr_diff");
             }
+            // Same output with the registers compacted
+            sprintf(buf, "../print_liveout -compact %s/%s > curr_out", dir, entry->d_name);
+            system(buf);
+            sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
+            system(buf);
+            system("rm curr_out");
+            stat("curr_diff", &st);
+            if (st.st_size != 0) {
+                printf("MISMATCH in %s (-compact)\n", entry->d_name);
+                break;
+            } else {
+                printf("\t\033[1;32m SUCCESS (-compact) \033[0m\n");
+                system("rm curr_diff");
+            }
+            // Liveness at every instruction, if there's a .points.out
+            sprintf(buf, "./%.*s.points.out", namelen - ext_len, entry->d_name);
+            if (access(buf, F_OK) != -1) {
+                sprintf(buf, "../print_liveout -points %s/%s > curr_out", dir, entry->d_name);
+                system(buf);
+                sprintf(buf, "diff curr_out ./%.*s.points.out > curr_diff", namelen - ext_len, entry->d_name);
+                system(buf);
+                system("rm curr_out");
+                stat("curr_diff", &st);
+                if (st.st_size != 0) {
+                    printf("MISMATCH in %s (-points)\n", entry->d_name);
+                    break;
+                } else {
+                    printf("\t\033[1;32m SUCCESS (-points) \033[0m\n");
+                    system("rm curr_diff");
+                }
+            }
+            // SSA liveness checker, if there's a .check.out
+            sprintf(buf, "./%.*s.check.out", namelen - ext_len, entry->d_name);
+            if (access(buf, F_OK) == -1)
+                continue;
+            sprintf(buf, "../print_liveout -check %s/%s > curr_out", dir, entry->d_name);
+            system(buf);
+            sprintf(buf, "diff curr_out ./%.*s.check.out > curr_diff", namelen - ext_len, entry->d_name);
+            system(buf);
+            system("rm curr_out");
+            stat("curr_diff", &st);
+            if (st.st_size != 0) {
+                printf("MISMATCH in %s (-check)\n", entry->d_name);
+                break;
+            } else {
+                printf("\t\033[1;32m SUCCESS (-check) \033[0m\n");
+                system("rm curr_diff");
+            }
         }
     }
     closedir(src);
@@ -3,17 +3,57 @@
 #include "../common/parser_ir.h"
 #include "../common/stefanos.h"
 
+#include "dvnt.h"
+#include "gvn.h"
 #include "lvn.h"
+#include "parallel_lvn.h"
+#include "stream_lvn.h"
 
+// Usage: apply_lvn [-dvnt | -gvn | -j N | -stream] file
+// With -dvnt, the values of the dominators of a block are reused too.
+// With -gvn, the whole procedure is numbered on SSA form (the registers are
+// renamed).
+// With -j N, per-block LVN runs on N threads (the output is the same).
+// With -stream, every block is printed (in the syntax of the input) as soon
+// as it's parsed and value-numbered, and `file` can be `-` for stdin.
 int main(int argc, char **argv) {
-  assert(argc == 2);
-  CFG cfg = parse_procedure(argv[1], NULL);
-  LVN lvn;
-  for (BasicBlock &bb : cfg.bbs) {
-    lvn.apply(&bb);
-    lvn.clear();
+  assert(argc == 2 || argc == 3 || argc == 4);
+  bool dvnt = false, gvn = false;
+  int nthreads = 1;
+  if (argc == 3 && !strcmp(argv[1], "-stream")) {
+    const char *filename = argv[2];
+    FILE *in = !strcmp(filename, "-") ? stdin : fopen(filename, "r");
+    assert(in);
+    stream_lvn(in, [](BasicBlock *bb) {
+      print_block_ir(stdout, bb);
+    });
+    if (in != stdin)
+      fclose(in);
+    return 0;
+  }
+  if (argc == 3) {
+    dvnt = !strcmp(argv[1], "-dvnt");
+    gvn = !strcmp(argv[1], "-gvn");
+    assert(dvnt || gvn);
+  } else if (argc == 4) {
+    assert(!strcmp(argv[1], "-j"));
+    nthreads = atoi(argv[2]);
+    assert(nthreads >= 1);
+  }
+  int max_reg;
+  CFG cfg = parse_procedure(argv[argc - 1], &max_reg);
+  if (gvn) {
+    GVN g;
+    g.apply(cfg, max_reg);
+    g.free();
+  } else if (dvnt) {
+    DVNT dv(cfg);
+    if (cfg.size())
+      dv.apply(cfg);
+    dv.free();
+  } else if (cfg.size()) {
+    parallel_lvn(cfg, nthreads);
   }
-  lvn.free();
   cfg.print();
   cfg.destruct();
 }
@@ -0,0 +1,347 @@
+#include <glob.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/interpreter.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+
+#include "dvnt.h"
+#include "gvn.h"
+#include "lvn.h"
+#include "parallel_lvn.h"
+#include "stream_lvn.h"
+
+/* Benchmark utilities */
+
+// A single block of `nelems` instructions. LVN must be linear in it, so the
+// time per instruction should stay the same as it grows. The code after LVN
+// must print the same values.
+static
+void lvn_benchmark(void) {
+ int set[] = { 1000, 16000, 64000, 256000, 1000000 };
+ printf("--- LVN on a single block ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   int nregs = MAX(16, set[i] / 8);
+   CFG orig = linear_cfg(1);
+   srand(set[i]);
+   populate_cfg(orig, nregs, set[i]);
+   CFG cfg = linear_cfg(1);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, set[i]);
+
+   double time_taken;
+   LVN lvn;
+   TIME_STMT(lvn.apply(&cfg.bbs[0]), time_taken);
+   lvn.free();
+
+   int removed = 0;
+   auto *o = orig.bbs[0].insts.head;
+   for (Instruction *inst : cfg.bbs[0].insts) {
+     Instruction *orig_inst = (Instruction *) o;
+     if (orig_inst->kind == INST::DEF && orig_inst->op.kind == OP_ADD &&
+         inst->op.kind == OP_SIMPLE) {
+       ++removed;
+     }
+     o = o->next;
+   }
+   InterpResult before = interpret(orig, nregs - 1, set[i]);
+   InterpResult after = interpret(cfg, nregs - 1, set[i]);
+   assert(before.finished && after.finished);
+   assert(before.output.len() == after.output.len());
+   LOOP(j, 0, before.output.len()) {
+     assert(before.output[j] == after.output[j]);
+   }
+
+   printf("Benchmark LVN: %d instructions: %.4lfs (%.1lfns per instruction, "
+          "%d additions replaced)\n", set[i], time_taken,
+          time_taken * 1e9 / set[i], removed);
+   before.free();
+   after.free();
+   cfg.destruct();
+   orig.destruct();
+ }
+ printf("\n");
+}
+
+static
+int count_adds(CFG cfg) {
+ int res = 0;
+ for (BasicBlock &bb : cfg.bbs) {
+   for (Instruction *inst : bb.insts) {
+     res += inst->kind == INST::DEF && inst->op.kind == OP_ADD;
+   }
+ }
+ return res;
+}
+
+template <typename VN>
+static
+void print_vn_stats(const char *name, int nelems, double time_taken, int adds,
+                    CFG cfg, const VN &vn) {
+ printf("Benchmark %s: %d elements: %.4lfs (additions: %d -> %d, %d reused, "
+        "%d folded; %d constants propagated)\n", name, nelems, time_taken, adds,
+        count_adds(cfg), vn.replaced, vn.folded, vn.propagated);
+}
+
+// Per-block LVN against DVNT (which includes the dominator tree) and GVN
+// (which includes the SSA construction and destruction).
+static
+void vn_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 16000, 64000 };
+ int nregs = 16, ninsts = 8;
+ int64_t max_steps = 1000000;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG orig = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(orig, nregs, ninsts);
+   CFG lvn_cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(lvn_cfg, nregs, ninsts);
+   CFG dvnt_cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(dvnt_cfg, nregs, ninsts);
+   CFG gvn_cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(gvn_cfg, nregs, ninsts);
+
+   double lvn_time_taken, dvnt_time_taken, gvn_time_taken;
+   LVN lvn;
+   TIME_STMT(lvn.apply_all(lvn_cfg), lvn_time_taken);
+   DVNT *dvnt;
+   TIME_STMT(
+     dvnt = new DVNT(dvnt_cfg);
+     dvnt->apply(dvnt_cfg), dvnt_time_taken);
+   GVN gvn;
+   TIME_STMT(gvn.apply(gvn_cfg, nregs - 1), gvn_time_taken);
+
+   InterpResult before = interpret(orig, nregs - 1, max_steps);
+   InterpResult after = interpret(dvnt_cfg, nregs - 1, max_steps);
+   assert(same_output(before, after));
+   after.free();
+   after = interpret(lvn_cfg, nregs - 1, max_steps);
+   assert(same_output(before, after));
+   after.free();
+   // Out of SSA adds copies, so it needs more steps.
+   after = interpret(gvn_cfg, gvn.max_register, 2 * max_steps);
+   assert(same_output(before, after));
+
+   int adds = count_adds(orig);
+   print_vn_stats("LVN", set[i], lvn_time_taken, adds, lvn_cfg, lvn);
+   print_vn_stats("DVNT", set[i], dvnt_time_taken, adds, dvnt_cfg, *dvnt);
+   print_vn_stats("GVN", set[i], gvn_time_taken, adds, gvn_cfg, gvn);
+   printf("  GVN: %d redundant phis\n", gvn.phis);
+   gvn.free();
+   lvn.free();
+   dvnt->free();
+   delete dvnt;
+   before.free();
+   after.free();
+   gvn_cfg.destruct();
+   dvnt_cfg.destruct();
+   lvn_cfg.destruct();
+   orig.destruct();
+ }
+ printf("\n");
+}
+
+// A chain of `nbbs` blocks where every 1000th block is 1000 times larger,
+// so that the work is skewed.
+static
+CFG skewed_cfg(int nbbs, int nregs) {
+ CFG cfg = linear_cfg(nbbs);
+ srand(nbbs);
+ populate_cfg(cfg, nregs, 4);
+ for (int bb = 0; bb < nbbs; bb += 1000) {
+   LOOP(i, 0, 4000) {
+     Value lhs = val_reg(rand() % nregs);
+     Value rhs = (rand() % 4) ? val_reg(rand() % nregs) : val_imm(rand() % 100);
+     cfg.bbs[bb].insert_inst_before_terminator(Instruction::def(rand() % nregs,
+                                                                op_add(lhs, rhs)));
+   }
+ }
+ return cfg;
+}
+
+static
+bool same_code(CFG a, CFG b) {
+ LOOP(bb, 0, a.size()) {
+   auto *n = b.bbs[bb].insts.head;
+   for (Instruction *inst : a.bbs[bb].insts) {
+     Instruction *other = (Instruction *) n;
+     if (inst->kind == INST::DEF &&
+         (inst->reg != other->reg || inst->op.kind != other->op.kind ||
+          inst->op.lhs != other->op.lhs ||
+          (inst->op.kind == OP_ADD && inst->op.rhs != other->op.rhs)))
+       return false;
+     n = n->next;
+   }
+ }
+ return true;
+}
+
+// Per-block LVN on 100k blocks with 1 to 8 threads. The code must be the
+// same as the sequential run.
+static
+void parallel_lvn_benchmark(void) {
+ int nbbs = 100000, nregs = 64;
+ int threads[] = { 1, 2, 4, 8 };
+ printf("--- Parallel LVN (%d blocks, %u hardware threads) ---\n", nbbs,
+        std::thread::hardware_concurrency());
+ CFG seq = skewed_cfg(nbbs, nregs);
+ LVN lvn;
+ double seq_time_taken;
+ TIME_STMT(lvn.apply_all(seq), seq_time_taken);
+ printf("Benchmark LVN: sequential: %.4lfs (%d reused, %d folded)\n",
+        seq_time_taken, lvn.replaced, lvn.folded);
+ LOOP(i, 0, (int) ARR_LEN(threads)) {
+   CFG cfg = skewed_cfg(nbbs, nregs);
+   double time_taken;
+   LVNStats stats;
+   TIME_STMT(stats = parallel_lvn(cfg, threads[i]), time_taken);
+   assert(same_code(seq, cfg));
+   assert(stats.replaced == lvn.replaced && stats.folded == lvn.folded &&
+          stats.propagated == lvn.propagated);
+   printf("Benchmark LVN: %d threads: %.4lfs (%d chunks stolen)\n", threads[i],
+          time_taken, stats.stolen);
+   cfg.destruct();
+ }
+ lvn.free();
+ seq.destruct();
+ printf("\n");
+}
+
+// Write a chain of `nbbs` blocks of `ninsts` random instructions to `out`.
+static
+void write_chain_ir(FILE *out, int nbbs, int ninsts, int nregs) {
+ srand(nbbs);
+ LOOP(bb, 0, nbbs) {
+   fprintf(out, "%s.%d:\n", bb ? "\n" : "", bb);
+   LOOP(i, 0, ninsts) {
+     int dst = rand() % nregs, lhs = rand() % nregs;
+     if (rand() % 2) {
+       fprintf(out, "  %%%d <- %%%d + %%%d\n", dst, lhs, rand() % nregs);
+     } else {
+       fprintf(out, "  %%%d <- %%%d + %d\n", dst, lhs, rand() % 4);
+     }
+   }
+   fprintf(out, "  PRINT %%%d\n", rand() % nregs);
+   if (bb != nbbs - 1) {
+     fprintf(out, "  BR .%d\n", bb + 1);
+   }
+ }
+}
+
+// Run `f` in a child process with the output to /dev/null and return its
+// peak memory (in KB).
+template <typename F>
+static
+long run_child(F f) {
+ fflush(stdout);
+ pid_t pid = fork();
+ assert(pid != -1);
+ if (!pid) {
+   assert(freopen("/dev/null", "w", stdout));
+   f();
+   fflush(stdout);
+   _exit(0);
+ }
+ int status;
+ struct rusage usage;
+ assert(wait4(pid, &status, 0, &usage) == pid);
+ assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+ return usage.ru_maxrss;
+}
+
+// Parse the whole file, apply LVN and print it, against doing it one block
+// at a time. The memory of the streaming run should not depend on the size
+// of the input.
+static
+void stream_lvn_benchmark(void) {
+ int set[] = { 10000, 100000, 400000 };
+ printf("--- Streaming LVN ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   char path[] = "/tmp/lvn_stream_XXXXXX";
+   int fd = mkstemp(path);
+   assert(fd != -1);
+   FILE *f = fdopen(fd, "w");
+   write_chain_ir(f, set[i], 8, 64);
+   fclose(f);
+
+   double whole_time_taken, stream_time_taken;
+   long whole_kb, stream_kb;
+   TIME_STMT(whole_kb = run_child([&path]() {
+     CFG cfg = parse_procedure(path, NULL);
+     LVN lvn;
+     lvn.apply_all(cfg);
+     lvn.free();
+     cfg.print();
+     cfg.destruct();
+   }), whole_time_taken);
+   TIME_STMT(stream_kb = run_child([&path]() {
+     FILE *in = fopen(path, "r");
+     assert(in);
+     stream_lvn(in, [](BasicBlock *bb) {
+       print_block_ir(stdout, bb);
+     });
+     fclose(in);
+   }), stream_time_taken);
+   printf("Benchmark LVN: %d blocks: whole procedure: %.4lfs, %ld KB, "
+          "streaming: %.4lfs, %ld KB\n", set[i], whole_time_taken, whole_kb,
+          stream_time_taken, stream_kb);
+   unlink(path);
+ }
+ printf("\n");
+}
+
+// The additions left in the examples of /IR.
+static
+void ir_files_report(void) {
+ glob_t files;
+ // DIR is taken by traversal.h, so no opendir().
+ assert(glob("../IR/*.ir", 0, NULL, &files) == 0);
+ printf("--- /IR ---\n");
+ LOOP(i, 0, (int) files.gl_pathc) {
+   const char *path = files.gl_pathv[i];
+   CFG lvn_cfg = parse_procedure(path, NULL);
+   CFG dvnt_cfg = parse_procedure(path, NULL);
+   int max_reg;
+   CFG gvn_cfg = parse_procedure(path, &max_reg);
+   int adds = count_adds(lvn_cfg);
+   LVN lvn;
+   lvn.apply_all(lvn_cfg);
+   DVNT dvnt(dvnt_cfg);
+   dvnt.apply(dvnt_cfg);
+   GVN gvn;
+   gvn.apply(gvn_cfg, max_reg);
+   printf("%s: additions: %d, after LVN: %d, after DVNT: %d, after GVN: %d\n",
+          path, adds, count_adds(lvn_cfg), count_adds(dvnt_cfg),
+          count_adds(gvn_cfg));
+   gvn.free();
+   lvn.free();
+   dvnt.free();
+   gvn_cfg.destruct();
+   dvnt_cfg.destruct();
+   lvn_cfg.destruct();
+ }
+ globfree(&files);
+ printf("\n");
+}
+
+int main() {
+  // First, so that the children don't inherit the memory of the others.
+  stream_lvn_benchmark();
+  ir_files_report();
+  lvn_benchmark();
+  parallel_lvn_benchmark();
+  vn_benchmark("FwdBack", fwdback_cfg);
+  vn_benchmark("DeepLoops", deep_loops_cfg);
+  vn_benchmark("Irreducible", irreducible_cfg);
+
+  return 0;
+}
@@ -1 +1,2 @@
-g++ apply_lvn.cpp -o apply_lvn
+g++ apply_lvn.cpp -o apply_lvn -pthread
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3 -pthread
@@ -0,0 +1,275 @@
+#ifndef DVNT_H
+#define DVNT_H
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+#include "../dominance/dtree.h"
+#include "lvn.h"
+
+/*
+Dominator-based value numbering (DVNT) - Briggs, Cooper & Simpson, "Value
+Numbering".
+
+LVN forgets everything between blocks. But the values computed in a block
+that dominates `B` are computed on every path to `B`, so we can keep them
+when we go to `B`. We walk the dominator tree in preorder with scoped
+tables: Entering a block opens a scope and leaving it undoes everything
+that was set in it (an undo log), so a block sees the numbers of its
+dominators and nothing from its siblings. The value numbers are never
+reused, so the expression table, (lnum, rnum) -> number, is a fact that
+holds everywhere and it's not scoped. What must hold for a reuse is that
+the holder of the number still has it here.
+
+The hazard: DVNT assumes SSA, where a register has one value everywhere.
+Here, a register may be redefined on a path from a dominator `D` to `B`
+that doesn't go through the blocks between them in the tree (e.g. in a
+loop or in a sibling branch), so what `D` knows about it may be stale in
+`B`. It's not stale if:
+- Every block from `D` to `B` in the dominator tree has a single
+  predecessor, its immediate dominator (an extended basic block). Then the
+  only path from `D` to `B` is through those blocks, which we have seen.
+- The register has a single definition in the whole procedure, and the
+  number came from it. Then it has that value everywhere after it.
+- The register is never defined (so, it's an input of the procedure).
+
+So, every scope has a barrier: the deepest block in the chain of
+dominators that is a join point (or a loop header). Anything a block above
+the barrier knows about a register is ignored, unless the second case
+holds. Immediates are never stale.
+
+Unreachable blocks are not in the tree and are numbered by themselves,
+like LVN.
+*/
+
+struct DVNT {
+  DVNT(CFG cfg) {
+    for (BasicBlock &bb : cfg.bbs) {
+      for (Instruction *inst : bb.insts) {
+        assert(inst->kind != INST::PHI);
+        if (inst->kind == INST::DEF) {
+          while (num_defs.len() <= (int) inst->reg) {
+            num_defs.push(0);
+          }
+          num_defs[inst->reg]++;
+        }
+      }
+    }
+    number_for_value.init();
+    number_for_add.init();
+    entries.push(ValEntry{0, 0, false});
+    value_for_number.push(0);
+    counter = 0;
+    replaced = folded = propagated = 0;
+  }
+
+  void apply(CFG cfg) {
+    if (!cfg.size())
+      return;
+    Buf<bool> visited;
+    visited.reserve_and_set(cfg.size());
+    LOOP(bb, 0, cfg.size()) {
+      visited[bb] = false;
+    }
+    DominatorTree dtree(cfg);
+    ExplicitDomTree edt(dtree);
+    for (int bb : edt.preorder) {
+      // Leave the scopes of the blocks that are not dominators of `bb`.
+      while (scopes.len() > edt.level(bb)) {
+        pop_scope();
+      }
+      const BasicBlock &b = cfg.bbs[bb];
+      bool ebb = bb != 0 && b.preds.len() == 1 && b.preds[0] == dtree.idom(bb);
+      push_scope(ebb);
+      apply(&cfg.bbs[bb]);
+      visited[bb] = true;
+    }
+    while (scopes.len()) {
+      pop_scope();
+    }
+    edt.free();
+    dtree.free();
+    LOOP(bb, 0, cfg.size()) {
+      if (!visited[bb]) {
+        push_scope(false);
+        apply(&cfg.bbs[bb]);
+        pop_scope();
+      }
+    }
+    visited.free();
+  }
+
+  void free() {
+    num_defs.free();
+    number_for_value.free();
+    number_for_add.free();
+    entries.free();
+    value_for_number.free();
+    scopes.free();
+    undo.free();
+  }
+
+  // Like LVN: additions replaced with a copy, additions simplified to a
+  // constant or an operand, and copies replaced with a constant.
+  int replaced, folded, propagated;
+
+private:
+  struct ValEntry {
+    int num;
+    // The depth of the scope it was set in.
+    int depth;
+    // Set by a definition of the register.
+    bool from_def;
+  };
+
+  struct Scope {
+    // Where its entries start in `undo`.
+    int undo_mark;
+    // Entries for registers from scopes shallower than that may be stale.
+    int barrier;
+  };
+
+  enum class TABLE {
+    VALUE,
+    HOLDER,
+  };
+
+  struct Undo {
+    TABLE table;
+    uint64_t key;
+    int old;
+  };
+
+  void push_scope(bool ebb) {
+    Scope s;
+    s.undo_mark = undo.len();
+    s.barrier = (ebb && scopes.len()) ? scopes.back().barrier : scopes.len();
+    scopes.push(s);
+  }
+
+  void pop_scope() {
+    int mark = scopes.back().undo_mark;
+    scopes.pop_back();
+    while (undo.len() > mark) {
+      Undo u = undo.back();
+      undo.pop_back();
+      switch (u.table) {
+      case TABLE::VALUE:
+        number_for_value.set(u.key, u.old);
+        break;
+      case TABLE::HOLDER:
+        value_for_number[u.key] = (Value) u.old;
+        break;
+      }
+    }
+  }
+
+  int depth() const {
+    return scopes.len() - 1;
+  }
+
+  // The number of `val` here or 0 if we don't know it.
+  int get_number(Value val) {
+    int idx = number_for_value.get(val);
+    if (!idx)
+      return 0;
+    ValEntry e = entries[idx];
+    if (val_kind(val) == VAL_REG && e.depth < scopes.back().barrier) {
+      int r = val_strip_kind(val);
+      int ndefs = (r < num_defs.len()) ? num_defs[r] : 0;
+      if (ndefs > 1 || (ndefs == 1 && !e.from_def))
+        return 0;
+    }
+    return e.num;
+  }
+
+  void set_number(Value val, int num, bool from_def) {
+    undo.push(Undo{TABLE::VALUE, val, number_for_value.get(val)});
+    entries.push(ValEntry{num, depth(), from_def});
+    number_for_value.set(val, entries.len() - 1);
+  }
+
+  bool holds(Value val, int num) {
+    return val_kind(val) == VAL_IMM || get_number(val) == num;
+  }
+
+  void set_holder(int num, Value val) {
+    undo.push(Undo{TABLE::HOLDER, (uint64_t) num, (int) value_for_number[num]});
+    value_for_number[num] = val;
+  }
+
+  int new_number(Value holder) {
+    ++counter;
+    value_for_number.push(holder);
+    return counter;
+  }
+
+  int get_number_for_value_or_create(Value val) {
+    int num = get_number(val);
+    if (num)
+      return num;
+    num = new_number(val);
+    set_number(val, num, false);
+    return num;
+  }
+
+  void assign(Value dst, int num) {
+    set_number(dst, num, true);
+    if (!holds(value_for_number[num], num)) {
+      set_holder(num, dst);
+    }
+  }
+
+  void apply(BasicBlock *bb) {
+    for (Instruction *i : bb->insts) {
+      if (i->kind != INST::DEF)
+        continue;
+      Value dst = val_reg(i->reg);
+      Value simple;
+      if (i->op.kind == OP_SIMPLE) {
+        int num = get_number_for_value_or_create(i->op.lhs);
+        if (lvn_propagate_constant(i->op.lhs, value_for_number[num], &simple)) {
+          i->op = op_simple(simple);
+          ++propagated;
+        }
+        assign(dst, num);
+        continue;
+      }
+      int lnum = get_number_for_value_or_create(i->op.lhs);
+      int rnum = get_number_for_value_or_create(i->op.rhs);
+      if (lvn_simplify_add(i->op, value_for_number[lnum],
+                           value_for_number[rnum], &simple)) {
+        i->op = op_simple(simple);
+        ++folded;
+        assign(dst, get_number_for_value_or_create(simple));
+        continue;
+      }
+      uint64_t key = lvn_add_key(lnum, rnum);
+      int num = number_for_add.get(key);
+      if (num && holds(value_for_number[num], num)) {
+        i->op = op_simple(value_for_number[num]);
+        ++replaced;
+      } else if (!num) {
+        num = new_number(dst);
+        number_for_add.set(key, num);
+      }
+      assign(dst, num);
+    }
+  }
+
+  /// Members ///
+
+  // Number of definitions of every register.
+  Buf<int> num_defs;
+  // Value -> index in `entries`
+  LVNTable number_for_value;
+  // (lnum, rnum) -> number
+  LVNTable number_for_add;
+  Buf<ValEntry> entries;
+  Buf<Value> value_for_number;
+  int counter;
+  Buf<Scope> scopes;
+  Buf<Undo> undo;
+};
+
+#endif
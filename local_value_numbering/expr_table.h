@@ -0,0 +1,164 @@
+#ifndef EXPR_TABLE_H
+#define EXPR_TABLE_H
+
+#include <string.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+
+// A hash table from expressions to the Value that computes them, for value
+// numbering over whole procedures (see gvn.h). LVN gets away with 64-bit
+// keys (`lvn_add_key()`), but the key of a phi has one operand per
+// predecessor, so here the operands of the entries are kept in one pool and
+// the table is open addressing over indices into the entries.
+//
+// The operands are whatever the client numbers values with (e.g. value
+// numbers that are themselves Values). Canonicalization (e.g. ordering the
+// operands of an addition) is the job of the client.
+//
+// Like `LVNTable`, `clear()` is O(1): The slots have a generation.
+
+enum class EXPR {
+  ADD,
+  // `block` is the block of the phi, since phis with the same arguments
+  // in different blocks are different values.
+  PHI,
+};
+
+typedef struct Expr {
+  EXPR kind;
+  int block;
+  const Value *ops;
+  int nops;
+} Expr;
+
+typedef struct ExprTable {
+  struct Entry {
+    uint64_t hash;
+    EXPR kind;
+    int block;
+    // Operands are `ops[ops_start .. ops_start + nops)`
+    int ops_start;
+    int nops;
+    Value val;
+  };
+
+  struct Slot {
+    int entry;
+    uint32_t gen;
+  };
+
+  Buf<Slot> slots;
+  Buf<Entry> entries;
+  Buf<Value> ops;
+  uint32_t gen;
+
+  void init() {
+    slots.reserve_and_set(16);
+    memset(slots.data, 0, slots.len() * sizeof(Slot));
+    gen = 1;
+  }
+
+  // If `e` is in the table, put its Value in `*val`.
+  bool lookup(Expr e, Value *val) {
+    Slot *s = find(e, hash(e));
+    if (s->gen != gen)
+      return false;
+    *val = entries[s->entry].val;
+    return true;
+  }
+
+  // If `e` is in the table, return its Value. Otherwise, insert it with
+  // `val` and return `val`.
+  Value lookup_or_insert(Expr e, Value val) {
+    uint64_t h = hash(e);
+    Slot *s = find(e, h);
+    if (s->gen == gen)
+      return entries[s->entry].val;
+    if (2 * (entries.len() + 1) > slots.len()) {
+      grow();
+      s = find(e, h);
+    }
+    Entry entry;
+    entry.hash = h;
+    entry.kind = e.kind;
+    entry.block = e.block;
+    entry.ops_start = ops.len();
+    entry.nops = e.nops;
+    entry.val = val;
+    LOOP(i, 0, e.nops) {
+      ops.push(e.ops[i]);
+    }
+    entries.push(entry);
+    s->entry = entries.len() - 1;
+    s->gen = gen;
+    return val;
+  }
+
+  int size() const {
+    return entries.len();
+  }
+
+  void clear() {
+    entries.clear();
+    ops.clear();
+    ++gen;
+    if (gen == 0) {
+      // Wrapped around; the old generations are not empty anymore.
+      memset(slots.data, 0, slots.len() * sizeof(Slot));
+      gen = 1;
+    }
+  }
+
+  void free() {
+    slots.free();
+    entries.free();
+    ops.free();
+  }
+
+private:
+  static uint64_t hash(Expr e) {
+    uint64_t h = ((uint64_t) e.kind << 32) | (uint32_t) e.block;
+    h *= 0x9E3779B97F4A7C15ULL;
+    LOOP(i, 0, e.nops) {
+      h = (h ^ e.ops[i]) * 0x9E3779B97F4A7C15ULL;
+    }
+    return h ^ (h >> 32);
+  }
+
+  bool equal(const Entry &entry, uint64_t h, Expr e) const {
+    if (entry.hash != h || entry.kind != e.kind || entry.block != e.block ||
+        entry.nops != e.nops)
+      return false;
+    return !memcmp(&ops.data[entry.ops_start], e.ops, e.nops * sizeof(Value));
+  }
+
+  // The slot of `e` or the empty slot where it would go.
+  Slot *find(Expr e, uint64_t h) {
+    size_t mask = slots.len() - 1;
+    size_t i = h & mask;
+    while (slots[i].gen == gen && !equal(entries[slots[i].entry], h, e)) {
+      i = (i + 1) & mask;
+    }
+    return &slots[i];
+  }
+
+  void grow() {
+    Buf<Slot> old = slots;
+    slots = Buf<Slot>();
+    slots.reserve_and_set(2 * old.len());
+    memset(slots.data, 0, slots.len() * sizeof(Slot));
+    LOOP(i, 0, entries.len()) {
+      size_t mask = slots.len() - 1;
+      size_t j = entries[i].hash & mask;
+      while (slots[j].gen == gen) {
+        j = (j + 1) & mask;
+      }
+      slots[j].entry = i;
+      slots[j].gen = gen;
+    }
+    old.free();
+  }
+} ExprTable;
+
+#endif
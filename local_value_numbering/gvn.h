@@ -0,0 +1,363 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/scc.h"
+#include "../common/stefanos.h"
+#include "../common/traversal.h"
+#include "../dominance/dtree.h"
+#include "../ssa/ssa.h"
+#include "expr_table.h"
+#include "lvn.h"
+
+/*
+Global value numbering with the SCC-based algorithm of Simpson (SCCVN; see
+Cooper & Simpson, "SCC-Based Value Numbering").
+
+DVNT only sees the values of the dominators of a block, so it can't tell
+that two phis (or two loop counters) are the same. Here, we number the
+whole procedure at once on SSA form, where a register has one value
+everywhere:
+
+1) The code is converted to (pruned) SSA (see /ssa/ssa.h).
+2) The SSA graph: a register points to the registers that its definition
+   uses. In SSA, every use is dominated by its definition, except for the
+   arguments of phis. So, the cycles of the graph go through phis (e.g. a
+   loop counter), and the SCCs of it (`scc_compute()`) are numbered
+   operands-first.
+3) The number of a register is a Value: the register that first computed
+   it (the leader) or a constant. An expression (an addition of two
+   numbers or a phi of its numbers in a block) is looked up in an
+   `ExprTable` and, if it's not there, the register is its leader.
+   Additions are simplified first like in LVN (see lvn.h).
+   - A component with one register that is not in a cycle is numbered once
+     with the `valid` table.
+   - The registers of a cycle are numbered optimistically: they start as
+     TOP (any value), which is ignored in the arguments of phis, and they
+     are renumbered with a fresh `optimistic` table until nothing changes
+     (an expression that is in the `valid` table is taken from there, like
+     GCC does). Then, they're numbered once more with the `valid` table,
+     which keeps only the facts that hold.
+   Two cycles that don't depend on each other are different components,
+   so, unlike the partitioning of Alpern, Wegman & Zadeck, this doesn't find
+   that e.g. two independent loop counters are the same.
+4) Elimination: A walk of the dominator tree, with the registers that are
+   available for every number (scoped like DVNT). A definition whose
+   number is a constant becomes the constant, and an addition whose number
+   is held by an operand or by a dominating register becomes a copy.
+5) Out of SSA.
+
+Phis are never removed (the naive out-of-SSA translation needs the
+conventional SSA we started with). For the same reason, the leader of a
+number can be a phi only in the block of the phi: After the copies of a
+phi are placed at the end of the predecessors, its register doesn't have
+the value of the phi on (critical) edges that leave the loop.
+
+Unreachable blocks are not renamed by the SSA construction and they're left
+alone. The arguments of phis from them are ignored. The phis of the entry
+are not numbered (they miss the values that come from outside).
+*/
+
+// Not a Value of the IR: The number of a register that hasn't been numbered
+// yet (during the optimistic numbering).
+#define GVN_TOP ((Value) 0xFFFFFFFF)
+
+struct GVN {
+  GVN() {
+    max_register = -1;
+    replaced = folded = propagated = phis = 0;
+  }
+
+  // Apply it to `cfg`, whose max register is `max_reg`. The registers are
+  // renamed (see SSA) and `max_register` is the max register after it.
+  void apply(CFG cfg, int max_reg) {
+    max_register = max_reg;
+    if (!cfg.size())
+      return;
+    SSAInfo info = ssa_construct(cfg, max_reg, SSA_KIND::PRUNED);
+    max_register = info.max_reg;
+    info.free();
+    DominatorTree dtree(cfg);
+    ExplicitDomTree edt(dtree);
+    valid.init();
+    optimistic.init();
+    collect_defs(cfg, edt);
+    number(cfg, edt);
+    eliminate(cfg, edt);
+    edt.free();
+    dtree.free();
+    ssa_destruct(cfg);
+  }
+
+  void free() {
+    def_of.free();
+    block_of.free();
+    order.free();
+    vn.free();
+    phi_args.free();
+    valid.free();
+    optimistic.free();
+  }
+
+  int max_register;
+  // Additions replaced with a copy of another register, additions that are
+  // constants or one of their operands, copies replaced with a constant, and
+  // phis that are the same as another value.
+  int replaced, folded, propagated, phis;
+
+private:
+  // The definitions (in reachable blocks) of the SSA registers and the
+  // defined registers in RPO.
+  void collect_defs(CFG cfg, const ExplicitDomTree &edt) {
+    int nregs = max_register + 1;
+    def_of.reserve_and_set(nregs);
+    block_of.reserve_and_set(nregs);
+    vn.reserve_and_set(nregs);
+    LOOP(r, 0, nregs) {
+      def_of[r] = NULL;
+      block_of[r] = -1;
+      // Registers without a definition are the inputs of the procedure.
+      vn[r] = val_reg(r);
+    }
+    for (int bb : cfg_rpo(cfg)) {
+      assert(edt.is_reachable_from_entry(bb));
+      for (Instruction *inst : cfg.bbs[bb].insts) {
+        if (inst->kind != INST::DEF && inst->kind != INST::PHI)
+          continue;
+        assert(!def_of[inst->reg]);
+        def_of[inst->reg] = inst;
+        block_of[inst->reg] = bb;
+        vn[inst->reg] = GVN_TOP;
+        order.push(inst->reg);
+      }
+    }
+  }
+
+  Value vn_of(Value v) const {
+    return (val_kind(v) == VAL_IMM) ? v : vn[val_strip_kind(v)];
+  }
+
+  Value lookup(Expr e, Value self, bool optimistic) {
+    if (!optimistic)
+      return valid.lookup_or_insert(e, self);
+    Value v;
+    if (valid.lookup(e, &v))
+      return v;
+    return this->optimistic.lookup_or_insert(e, self);
+  }
+
+  // The number of `r`, a register with a definition, given the numbers of
+  // its operands.
+  Value value_number(CFG cfg, const ExplicitDomTree &edt, int r,
+                     bool optimistic) {
+    Instruction *inst = def_of[r];
+    Value self = val_reg(r);
+    Value top = optimistic ? GVN_TOP : self;
+    if (inst->kind == INST::PHI) {
+      // The entry may have predecessors, but the values that come from
+      // outside the procedure are not arguments of its phis.
+      if (block_of[r] == 0)
+        return self;
+      const BasicBlock &bb = cfg.bbs[block_of[r]];
+      phi_args.clear();
+      Value same = GVN_TOP;
+      bool all_same = true;
+      LOOP(j, 0, bb.preds.len()) {
+        if (!edt.is_reachable_from_entry(bb.preds[j]))
+          continue;
+        Value arg = vn_of(inst->phi_args[j]);
+        phi_args.push(arg);
+        if (arg == GVN_TOP)
+          continue;
+        if (same == GVN_TOP) {
+          same = arg;
+        } else if (arg != same) {
+          all_same = false;
+        }
+      }
+      if (same == GVN_TOP)
+        return top;
+      if (all_same)
+        return same;
+      Expr e = { EXPR::PHI, block_of[r], phi_args.data, (int) phi_args.len() };
+      return lookup(e, self, optimistic);
+    }
+
+    assert(inst->kind == INST::DEF);
+    Value lhs = vn_of(inst->op.lhs);
+    if (lhs == GVN_TOP)
+      return top;
+    if (inst->op.kind == OP_SIMPLE)
+      return lhs;
+    Value rhs = vn_of(inst->op.rhs);
+    if (rhs == GVN_TOP)
+      return top;
+    Value simple;
+    if (lvn_simplify_add(op_add(lhs, rhs), lhs, rhs, &simple))
+      return simple;
+    Value ops[2] = { MIN(lhs, rhs), MAX(lhs, rhs) };
+    Expr e = { EXPR::ADD, -1, ops, 2 };
+    return lookup(e, self, optimistic);
+  }
+
+  void number(CFG cfg, const ExplicitDomTree &edt) {
+    int nregs = max_register + 1;
+    Buf<Buf<int>> operands;
+    operands.reserve_and_set(nregs);
+    operands.initialize();
+    auto add_operand = [&operands](int r, Value v) {
+      if (val_kind(v) == VAL_REG) {
+        operands[r].push(val_strip_kind(v));
+      }
+    };
+    for (int r : order) {
+      Instruction *inst = def_of[r];
+      if (inst->kind == INST::PHI) {
+        for (Value arg : inst->phi_args) {
+          add_operand(r, arg);
+        }
+      } else {
+        add_operand(r, inst->op.lhs);
+        if (inst->op.kind == OP_ADD) {
+          add_operand(r, inst->op.rhs);
+        }
+      }
+    }
+    SCCs sccs = scc_compute(nregs, [&operands](int r) -> const Buf<int> & {
+      return operands[r];
+    });
+    sccs.order_members_by(order);
+
+    LOOP(c, 0, sccs.size()) {
+      if (sccs.is_cyclic(c)) {
+        bool changed = true;
+        while (changed) {
+          changed = false;
+          optimistic.clear();
+          for (const int *r = sccs.members_begin(c); r != sccs.members_end(c); ++r) {
+            Value v = value_number(cfg, edt, *r, true);
+            if (v != vn[*r]) {
+              vn[*r] = v;
+              changed = true;
+            }
+          }
+        }
+      }
+      for (const int *r = sccs.members_begin(c); r != sccs.members_end(c); ++r) {
+        if (def_of[*r]) {
+          vn[*r] = value_number(cfg, edt, *r, false);
+        }
+      }
+    }
+    sccs.free();
+    for (Buf<int> &ops : operands) {
+      ops.free();
+    }
+    operands.free();
+  }
+
+  void eliminate(CFG cfg, const ExplicitDomTree &edt) {
+    int nregs = max_register + 1;
+    // The register that is available for every number (which is a
+    // register) or -1, and the block of it if it's a phi or -1.
+    struct Avail {
+      int reg;
+      int phi_block;
+    };
+    Buf<Avail> avail;
+    avail.reserve_and_set(nregs);
+    LOOP(r, 0, nregs) {
+      avail[r] = Avail{-1, -1};
+    }
+    struct Undo {
+      int num;
+      Avail old;
+    };
+    Buf<Undo> undo;
+    Buf<int> marks;
+
+    for (int bb : edt.preorder) {
+      while (marks.len() > edt.level(bb)) {
+        int mark = marks.back();
+        marks.pop_back();
+        while (undo.len() > mark) {
+          Undo u = undo.back();
+          undo.pop_back();
+          avail[u.num] = u.old;
+        }
+      }
+      marks.push(undo.len());
+      auto usable = [&avail, bb](int num) {
+        return avail[num].reg != -1 &&
+               (avail[num].phi_block == -1 || avail[num].phi_block == bb);
+      };
+      auto make_available = [&](int num, int r, int phi_block) {
+        undo.push(Undo{num, avail[num]});
+        avail[num] = Avail{r, phi_block};
+      };
+
+      for (Instruction *inst : cfg.bbs[bb].insts) {
+        if (inst->kind != INST::DEF && inst->kind != INST::PHI)
+          continue;
+        int r = inst->reg;
+        Value num = vn[r];
+        if (inst->kind == INST::PHI) {
+          if (num != val_reg(r)) {
+            ++phis;
+          }
+          if (val_kind(num) == VAL_REG && !usable(val_strip_kind(num))) {
+            make_available(val_strip_kind(num), r, bb);
+          }
+          continue;
+        }
+        if (val_kind(num) == VAL_IMM) {
+          if (inst->op.kind == OP_ADD) {
+            inst->op = op_simple(num);
+            ++folded;
+          } else if (inst->op.lhs != num) {
+            inst->op = op_simple(num);
+            ++propagated;
+          }
+          continue;
+        }
+        int n = val_strip_kind(num);
+        if (inst->op.kind == OP_ADD) {
+          if (vn_of(inst->op.lhs) == num || vn_of(inst->op.rhs) == num) {
+            Value operand = (vn_of(inst->op.lhs) == num) ? inst->op.lhs : inst->op.rhs;
+            inst->op = op_simple(operand);
+            ++folded;
+            continue;
+          }
+          if (usable(n)) {
+            inst->op = op_simple(val_reg(avail[n].reg));
+            ++replaced;
+            continue;
+          }
+        }
+        if (!usable(n)) {
+          make_available(n, r, -1);
+        }
+      }
+    }
+    marks.free();
+    undo.free();
+    avail.free();
+  }
+
+  /// Members ///
+
+  // The definition of every SSA register and its block (NULL and -1 if it
+  // has none).
+  Buf<Instruction *> def_of;
+  Buf<int> block_of;
+  // The registers with a definition, in RPO.
+  Buf<int> order;
+  // The number of every register.
+  Buf<Value> vn;
+  // Scratch for the key of a phi.
+  Buf<Value> phi_args;
+  ExprTable valid, optimistic;
+};
+
+#endif
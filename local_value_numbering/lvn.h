@@ -1,127 +1,248 @@
 #ifndef LVN_H
 #define LVN_H
 
+#include <string.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+
 #if 0
 #define DEBUG(block) block
 #else
 #define DEBUG(block) 
 #endif
 
-// TODO: This might seem a really bad implementation as far as data-structures
-// are concerned, but actually it's not very bad. Usually basic
-// blocks are really small (5-10 instructions), so the buffers we're searching
-// are really small (i.e. the whole buffer can fit in a couple of cache lines).
-// Now, ideally we would convert them to SOA in which case,
-// for most basic blocks, each buffer will fit in a cache line or two at most.
+// Blocks can have thousands of instructions (e.g. generated code), so the
+// lookups are hash tables and LVN is linear in the size of the block:
+// - Value -> number and (lnum, rnum) -> number: `LVNTable`, open addressing
+//   with linear probing.
+// - number -> Value: an array, since the numbers of a block are [1, counter].
+//
+// `clear()` is called between blocks and it is O(1): Every slot of a table
+// has the generation it was written in, and a slot from an older generation
+// is empty. So, we don't touch the tables to clear them.
+//
+// The IR is not SSA, so the register that first got a number may have been
+// redefined when we want to reuse it (e.g. `%1 <- %2 + %3`, `%1 <- 5`,
+// `%4 <- %2 + %3`). So, before we use the holder of a number, we check that
+// it still has the number, and if it doesn't, the next register that gets
+// the number becomes the holder.
 
-struct LVN {
-private:
-  struct ValueNumber {
-    Value val;
+// Besides reusing values, LVN simplifies:
+// - Commutativity: `%1 + %2` and `%2 + %1` get the same number (the key of
+//   an addition has the smaller number first).
+// - Constant folding: An addition of two constants becomes the constant,
+//   with the wraparound of the IR (see `imm_add()`). We know that a number
+//   is a constant if its holder is an immediate.
+// - Identities: `x + 0` and `0 + x` become `x`.
+// - A copy of a register that has a constant becomes the constant.
+
+// The key of an addition of the numbers `lnum` and `rnum`. The smaller
+// goes first since it's commutative.
+static
+uint64_t lvn_add_key(int lnum, int rnum) {
+  uint32_t lo = MIN(lnum, rnum), hi = MAX(lnum, rnum);
+  return ((uint64_t) lo << 32) | hi;
+}
+
+// If `op` (an ADD) is a constant or one of its operands, put it in `*res`.
+// `lholder` and `rholder` are the holders of the numbers of the operands
+// (an immediate holder means that the operand is a constant).
+static
+bool lvn_simplify_add(Operation op, Value lholder, Value rholder, Value *res) {
+  assert(op.kind == OP_ADD);
+  bool lconst = val_kind(lholder) == VAL_IMM;
+  bool rconst = val_kind(rholder) == VAL_IMM;
+  if (lconst && rconst) {
+    *res = val_imm(imm_add(val_strip_kind(lholder), val_strip_kind(rholder)));
+    return true;
+  }
+  if (lconst && val_strip_kind(lholder) == 0) {
+    *res = op.rhs;
+    return true;
+  }
+  if (rconst && val_strip_kind(rholder) == 0) {
+    *res = op.lhs;
+    return true;
+  }
+  return false;
+}
+
+// If `v` is a register whose number is a constant (`holder` is an
+// immediate), put the constant in `*res`.
+static
+bool lvn_propagate_constant(Value v, Value holder, Value *res) {
+  if (val_kind(v) != VAL_REG || val_kind(holder) != VAL_IMM)
+    return false;
+  *res = holder;
+  return true;
+}
+
+// Open-addressing hash table from 64-bit keys to numbers, with O(1) clear().
+typedef struct LVNTable {
+  struct Slot {
+    uint64_t key;
     int num;
+    uint32_t gen;
   };
-  
-  struct LVNAdd {
-    int lnum, rnum;
-  
-    bool operator==(LVNAdd add) {
-      return (add.lnum == lnum) && (add.rnum == rnum);
+
+  Buf<Slot> slots;
+  // Live entries in the current generation.
+  int size;
+  uint32_t gen;
+
+  void init() {
+    slots.reserve_and_set(16);
+    memset(slots.data, 0, slots.len() * sizeof(Slot));
+    size = 0;
+    gen = 1;
+  }
+
+  // The slot of `key` or the empty slot where it would go.
+  Slot *find(uint64_t key) {
+    size_t mask = slots.len() - 1;
+    size_t i = (key * 0x9E3779B97F4A7C15ULL) >> 32 & mask;
+    while (slots[i].gen == gen && slots[i].key != key) {
+      i = (i + 1) & mask;
     }
-  };
-  
-  struct AddNumber {
-    LVNAdd lvn_add;
-    int num;
-  };
+    return &slots[i];
+  }
 
+  // The number of `key` or 0 if it has none.
+  int get(uint64_t key) {
+    Slot *s = find(key);
+    return (s->gen == gen) ? s->num : 0;
+  }
 
-  Buf<ValueNumber> number_for_value;
-  Buf<AddNumber> number_for_add;
-  int counter = 0;
-  
-  ValueNumber get_number_for_value_or_create(Value val) {
-    for (ValueNumber vnum : number_for_value) {
-      if (vnum.val == val)
-        return vnum;
+  void set(uint64_t key, int num) {
+    Slot *s = find(key);
+    if (s->gen != gen) {
+      if (2 * (size + 1) > (int) slots.len()) {
+        grow();
+        s = find(key);
+      }
+      ++size;
+      s->key = key;
+      s->gen = gen;
+    }
+    s->num = num;
+  }
+
+  void clear() {
+    size = 0;
+    ++gen;
+    if (gen == 0) {
+      // Wrapped around; the old generations are not empty anymore.
+      memset(slots.data, 0, slots.len() * sizeof(Slot));
+      gen = 1;
+    }
+  }
+
+  void free() {
+    slots.free();
+  }
+
+private:
+  void grow() {
+    Buf<Slot> old = slots;
+    slots = Buf<Slot>();
+    slots.reserve_and_set(2 * old.len());
+    memset(slots.data, 0, slots.len() * sizeof(Slot));
+    for (Slot s : old) {
+      if (s.gen == gen) {
+        *find(s.key) = s;
+      }
     }
+    old.free();
+  }
+} LVNTable;
+
+struct LVN {
+private:
+  LVNTable number_for_value;
+  LVNTable number_for_add;
+  // The Value that holds every number (index 0 is unused).
+  Buf<Value> value_for_number;
+  int counter = 0;
+
+  int new_number(Value holder) {
     ++counter;
- 
-    DEBUG( 
-      printf("1) %d for: ", counter);
+    if (value_for_number.len() <= counter) {
+      value_for_number.push(holder);
+    } else {
+      value_for_number[counter] = holder;
+    }
+    return counter;
+  }
+
+  int get_number_for_value_or_create(Value val) {
+    int num = number_for_value.get(val);
+    if (num)
+      return num;
+    num = new_number(val);
+
+    DEBUG(
+      printf("1) %d for: ", num);
       val_print(val);
       printf("\n");
     )
-  
-    ValueNumber vnum = { .val = val, .num = counter };
-    number_for_value.push(vnum);
-    return vnum;
-  }
-  
-  int set_number_for_value_or_create(Value val, int num) {
-    for (ValueNumber &vnum : number_for_value) {
-      if (vnum.val == val) {
-        vnum.num = num;
-  
-        DEBUG(
-          printf("2) %d for: ", num);
-          val_print(val);
-          printf("\n");
-        )
-  
-        return num;
-      }
-    }
-  
+
+    number_for_value.set(val, num);
+    return num;
+  }
+
+  // Does `val` still have the number `num`? Immediates never change.
+  bool holds(Value val, int num) {
+    return val_kind(val) == VAL_IMM || number_for_value.get(val) == num;
+  }
+
+  int set_number_for_value(Value val, int num) {
     DEBUG(
-      printf("3) %d for: ", num);
+      printf("2) %d for: ", num);
       val_print(val);
       printf("\n");
     )
-  
-    ValueNumber vnum = { .val = val, .num = num };
-    number_for_value.push(vnum);
+
+    number_for_value.set(val, num);
+    if (!holds(value_for_number[num], num)) {
+      value_for_number[num] = val;
+    }
     return num;
   }
-  
-  Value get_value_for_number(int num) {
-    for (ValueNumber vnum : number_for_value) {
-      if (vnum.num == num) {
-        return vnum.val;
-      }
-    }
-    assert(0);
+
+  // The Value that holds `num` or false if it was redefined.
+  bool get_value_for_number(int num, Value *val) {
+    *val = value_for_number[num];
+    return holds(*val, num);
   }
-  
+
   // Return true if it created, otherwise false.
-  bool get_number_for_lvnadd_or_create(LVNAdd add, int *num) {
-    for (AddNumber add_num : number_for_add) {
-      if (add_num.lvn_add == add) {
-        *num = add_num.num;
-        return false;
-      }
-    }
-    ++counter;
-  
-    DEBUG(printf("4) %d for: (%d) + (%d)\n", counter, add.lnum, add.rnum);)
-  
-    AddNumber add_num = { .lvn_add = add, .num = counter };
-    number_for_add.push(add_num);
-    *num = counter;
+  bool get_number_for_lvnadd_or_create(int lnum, int rnum, Value dst, int *num) {
+    uint64_t key = lvn_add_key(lnum, rnum);
+    *num = number_for_add.get(key);
+    if (*num)
+      return false;
+    *num = new_number(dst);
+
+    DEBUG(printf("4) %d for: (%d) + (%d)\n", *num, lnum, rnum);)
+
+    number_for_add.set(key, *num);
     return true;
   }
-  
-  // Return true if it created
-  bool op_add(Operation op, int *lvn_add_num) {
-    assert(op.kind == OP_ADD);
-    int lnum = get_number_for_value_or_create(op.lhs).num;
-    int rnum = get_number_for_value_or_create(op.rhs).num;
-    LVNAdd lvn_add = { .lnum = lnum, .rnum = rnum };
-    return get_number_for_lvnadd_or_create(lvn_add, lvn_add_num);
-  }
-  
+
 
 public:
 
+  // Additions replaced with a copy, additions simplified to a constant or
+  // an operand, and copies replaced with a constant.
+  int replaced = 0, folded = 0, propagated = 0;
+
+  LVN() {
+    number_for_value.init();
+    number_for_add.init();
+    value_for_number.push(0);
+  }
+
   void clear() {
     number_for_value.clear();
     number_for_add.clear();
@@ -131,28 +252,74 @@ public:
   void apply(BasicBlock *bb) {
     DEBUG(printf("---------------\n");)
     for (Instruction *i : bb->insts) {
-      if (i->kind == INST::DEF) {
-        if (i->op.kind == OP_ADD) {
-          int lvn_add_num;
-          bool created = op_add(i->op, &lvn_add_num);
-          set_number_for_value_or_create(val_reg(i->reg), lvn_add_num);
-          if (!created) {
-            DEBUG(printf("%d AGAIN!\n", lvn_add_num);)
-            Value copy = get_value_for_number(lvn_add_num);
-            i->op = op_simple(copy);
-          }
-        } else {
-          int num = get_number_for_value_or_create(i->op.lhs).num;
-          set_number_for_value_or_create(val_reg(i->reg), num);
+      if (i->kind != INST::DEF)
+        continue;
+      Value dst = val_reg(i->reg);
+      Value simple;
+      if (i->op.kind == OP_ADD) {
+        int lnum = get_number_for_value_or_create(i->op.lhs);
+        int rnum = get_number_for_value_or_create(i->op.rhs);
+        if (lvn_simplify_add(i->op, value_for_number[lnum],
+                             value_for_number[rnum], &simple)) {
+          i->op = op_simple(simple);
+          ++folded;
+          set_number_for_value(dst, get_number_for_value_or_create(simple));
+          continue;
         }
+        int lvn_add_num;
+        bool created = get_number_for_lvnadd_or_create(lnum, rnum, dst, &lvn_add_num);
+        Value copy;
+        bool reuse = !created && get_value_for_number(lvn_add_num, &copy);
+        set_number_for_value(dst, lvn_add_num);
+        if (reuse) {
+          DEBUG(printf("%d AGAIN!\n", lvn_add_num);)
+          i->op = op_simple(copy);
+          ++replaced;
+        }
+      } else {
+        int num = get_number_for_value_or_create(i->op.lhs);
+        if (lvn_propagate_constant(i->op.lhs, value_for_number[num], &simple)) {
+          i->op = op_simple(simple);
+          ++propagated;
+        }
+        set_number_for_value(dst, num);
       }
     }
   }
 
+  // Apply it to `bb` and clear the tables for the next block. The counts
+  // (`replaced` etc.) keep adding up.
+  void apply_block(BasicBlock *bb) {
+    apply(bb);
+    clear();
+  }
+
+  // Apply it to the blocks [begin, end) of `cfg`, each on its own.
+  void apply_range(CFG cfg, int begin, int end) {
+    LOOP(bb, begin, end) {
+      apply_block(&cfg.bbs[bb]);
+    }
+  }
+
+  void apply_all(CFG cfg) {
+    apply_range(cfg, 0, cfg.size());
+  }
+
   void free() {
     number_for_value.free();
     number_for_add.free();
+    value_for_number.free();
   }
 };
 
+// What a driver of LVN over many blocks did (see parallel_lvn.h and
+// stream_lvn.h).
+typedef struct LVNStats {
+  // Like LVN
+  int replaced, folded, propagated;
+  // Chunks that were taken from the range of another thread (only for
+  // parallel_lvn()).
+  int stolen;
+} LVNStats;
+
 #endif
@@ -0,0 +1,157 @@
+#ifndef PARALLEL_LVN_H
+#define PARALLEL_LVN_H
+
+#include <mutex>
+#include <thread>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+#include "lvn.h"
+
+/*
+Per-block LVN on many threads. LVN doesn't look outside the block and it
+only rewrites the operations of the block in place, so the blocks can be
+numbered in any order and on any thread, and the result is the same as the
+sequential run (LVN starts from a clear state in every block; the numbers
+themselves never show up in the code).
+
+- Every thread has its own LVN (the tables are not shared).
+- The blocks are split into chunks of consecutive blocks with about the
+  same number of instructions (`lvn_chunks()`), a few per thread, and every
+  thread starts with a range of consecutive chunks.
+- Work stealing: A thread takes chunks from the front of its range, and when
+  it runs out, it takes the last chunk of the range of another thread. So, if
+  a few blocks are much larger than the rest (and a chunk can't split a
+  block), the threads that finish early help the others. Every range has a
+  mutex; a chunk is a lot of work compared to taking it.
+*/
+
+// The chunks per thread. More chunks balance better, but we take the lock
+// more.
+#define PLVN_CHUNKS_PER_THREAD 8
+
+typedef struct LVNChunk {
+  // Blocks [begin, end)
+  int begin, end;
+} LVNChunk;
+
+// Split the blocks of `cfg` into at most `nchunks` chunks of consecutive
+// blocks with about the same number of instructions.
+static
+Buf<LVNChunk> lvn_chunks(CFG cfg, int nchunks) {
+  int nbbs = cfg.size();
+  Buf<int64_t> ninsts;
+  ninsts.reserve_and_set(nbbs);
+  int64_t total = 0;
+  LOOP(bb, 0, nbbs) {
+    int64_t n = 0;
+    for (Instruction *inst : cfg.bbs[bb].insts) {
+      (void) inst;
+      ++n;
+    }
+    ninsts[bb] = n;
+    total += n;
+  }
+  Buf<LVNChunk> chunks;
+  int64_t target = MAX((int64_t) 1, (total + nchunks - 1) / nchunks);
+  int64_t acc = 0;
+  int begin = 0;
+  LOOP(bb, 0, nbbs) {
+    acc += ninsts[bb];
+    if (acc >= target * (chunks.len() + 1) || bb == nbbs - 1) {
+      chunks.push(LVNChunk{begin, bb + 1});
+      begin = bb + 1;
+    }
+  }
+  ninsts.free();
+  return chunks;
+}
+
+// Apply LVN to every block of `cfg` with `nthreads` threads.
+static
+LVNStats parallel_lvn(CFG cfg, int nthreads) {
+  assert(nthreads >= 1);
+  LVNStats stats = {0, 0, 0, 0};
+  Buf<LVNChunk> chunks = lvn_chunks(cfg, nthreads * PLVN_CHUNKS_PER_THREAD);
+  nthreads = MIN(nthreads, (int) chunks.len());
+  if (nthreads <= 1) {
+    LVN lvn;
+    lvn.apply_all(cfg);
+    stats.replaced = lvn.replaced;
+    stats.folded = lvn.folded;
+    stats.propagated = lvn.propagated;
+    lvn.free();
+    chunks.free();
+    return stats;
+  }
+
+  // The chunks [begin, end) that are left to every thread.
+  struct Range {
+    std::mutex m;
+    int begin, end;
+  };
+  Range *ranges = new Range[nthreads];
+  LOOP(t, 0, nthreads) {
+    ranges[t].begin = (int) ((int64_t) chunks.len() * t / nthreads);
+    ranges[t].end = (int) ((int64_t) chunks.len() * (t + 1) / nthreads);
+  }
+  auto take_own = [ranges](int t) {
+    std::lock_guard<std::mutex> lock(ranges[t].m);
+    if (ranges[t].begin == ranges[t].end)
+      return -1;
+    return ranges[t].begin++;
+  };
+  auto steal = [ranges, nthreads](int t) {
+    LOOP(i, 1, nthreads) {
+      Range &victim = ranges[(t + i) % nthreads];
+      std::lock_guard<std::mutex> lock(victim.m);
+      if (victim.begin != victim.end)
+        return --victim.end;
+    }
+    return -1;
+  };
+
+  Buf<LVNStats> thread_stats;
+  thread_stats.reserve_and_set(nthreads);
+  auto work = [&](int t) {
+    LVN lvn;
+    int stolen = 0;
+    while (true) {
+      int c = take_own(t);
+      if (c == -1) {
+        c = steal(t);
+        if (c == -1)
+          break;
+        ++stolen;
+      }
+      lvn.apply_range(cfg, chunks[c].begin, chunks[c].end);
+    }
+    thread_stats[t] = LVNStats{lvn.replaced, lvn.folded, lvn.propagated, stolen};
+    lvn.free();
+  };
+
+  // Not a Buf; std::thread can't be copied with memcpy().
+  std::thread *threads = new std::thread[nthreads - 1];
+  LOOP(t, 1, nthreads) {
+    threads[t - 1] = std::thread(work, t);
+  }
+  // The calling thread is thread 0.
+  work(0);
+  LOOP(t, 0, nthreads - 1) {
+    threads[t].join();
+  }
+
+  for (LVNStats s : thread_stats) {
+    stats.replaced += s.replaced;
+    stats.folded += s.folded;
+    stats.propagated += s.propagated;
+    stats.stolen += s.stolen;
+  }
+  delete[] threads;
+  thread_stats.free();
+  delete[] ranges;
+  chunks.free();
+  return stats;
+}
+
+#endif
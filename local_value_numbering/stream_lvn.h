@@ -0,0 +1,79 @@
+#ifndef STREAM_LVN_H
+#define STREAM_LVN_H
+
+#include <stdio.h>
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+#include "lvn.h"
+
+// LVN doesn't need anything outside the block, so it can run as soon as a
+// block is parsed: `stream_lvn()` parses the procedure in `in` one block at
+// a time (see `parse_stream()`), applies LVN to it and passes it to
+// `consume(BasicBlock *)`, while it's still in the cache. Only one block is
+// in memory, so the input can be as large as we want (e.g. through a pipe).
+//
+// The block is freed after `consume()` returns. It has no `preds`.
+template <typename Consumer>
+static
+LVNStats stream_lvn(FILE *in, Consumer consume, int *max_reg = NULL) {
+  LVN lvn;
+  parse_stream(in, [&lvn, &consume](BasicBlock *bb) {
+    lvn.apply_block(bb);
+    consume(bb);
+  }, max_reg);
+  LVNStats stats = {lvn.replaced, lvn.folded, lvn.propagated, 0};
+  lvn.free();
+  return stats;
+}
+
+// A consumer that prints the block in the syntax of the input, so that the
+// output can be parsed again (e.g. piped to another pass). The blocks are
+// separated by a blank line (the parser doesn't want one at the end).
+static
+void print_block_ir(FILE *out, BasicBlock *bb) {
+  auto value = [out](Value v) {
+    if (val_kind(v) == VAL_REG) {
+      fprintf(out, "%%%u", val_strip_kind(v));
+    } else {
+      fprintf(out, "%u", val_strip_kind(v));
+    }
+  };
+  auto operation = [&value, out](Operation op) {
+    value(op.lhs);
+    if (op.kind == OP_ADD) {
+      fprintf(out, " + ");
+      value(op.rhs);
+    }
+  };
+  if (bb->num) {
+    fprintf(out, "\n");
+  }
+  fprintf(out, ".%d:\n", bb->num);
+  for (Instruction *inst : bb->insts) {
+    fprintf(out, "  ");
+    switch (inst->kind) {
+    case INST::DEF:
+      fprintf(out, "%%%u <- ", inst->reg);
+      operation(inst->op);
+      break;
+    case INST::PRINT:
+      fprintf(out, "PRINT ");
+      operation(inst->op);
+      break;
+    case INST::BR_UNCOND:
+      fprintf(out, "BR .%d", inst->uncond_lbl);
+      break;
+    case INST::BR_COND:
+      fprintf(out, "BR ");
+      value(inst->cond_val);
+      fprintf(out, ", .%d, .%d", inst->then, inst->els);
+      break;
+    default:
+      assert(0);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+#endif
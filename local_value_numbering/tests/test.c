@@ -33,39 +33,74 @@ int main()
 
     int ext_len = strlen(".ir");
 
-    const char *dir = "./";
+    // The examples of /IR are checked only if they have goldens here.
+    const char *dirs[] = { "./", "../../IR" };
 
-    src = opendir(dir);
-    assert(src);
-    while ((entry = readdir(src)))
+    for (int d = 0; d < 2; ++d)
     {
-        int namelen;
-        if (ends_with(entry->d_name, ".ir", &namelen))
+        const char *dir = dirs[d];
+        src = opendir(dir);
+        assert(src);
+        while ((entry = readdir(src)))
         {
-            char buf[512];
-            struct stat st;
-            printf("- %s\n", entry->d_name);
-            sprintf(buf, "./%.*s.out", namelen - ext_len, entry->d_name);
-            if (access(buf, F_OK) == -1) {
-                printf("\t\033[1;31m No .out \033[0m\n");
-                continue;
-            }
-            sprintf(buf, "../apply_lvn %s/%s > curr_out", dir, entry->d_name);
-            system(buf);
-            sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
-            system(buf);
-            system("rm curr_out");
-            stat("curr_diff", &st);
-            if (st.st_size != 0) {
-                printf("MISMATCH in %s\n", entry->d_name);
-                break;
-            } else {
-                printf("\t\033[1;32m SUCCESS \033[0m\n");
-                system("rm curr_diff");
+            int namelen;
+            if (ends_with(entry->d_name, ".ir", &namelen))
+            {
+                char buf[512];
+                struct stat st;
+                sprintf(buf, "./%.*s.out", namelen - ext_len, entry->d_name);
+                if (access(buf, F_OK) == -1) {
+                    if (d == 0) {
+                        printf("- %s\n", entry->d_name);
+                        printf("\t\033[1;31m No .out \033[0m\n");
+                    }
+                    continue;
+                }
+                printf("- %s\n", entry->d_name);
+                sprintf(buf, "../apply_lvn %s/%s > curr_out", dir, entry->d_name);
+                system(buf);
+                sprintf(buf, "diff curr_out ./%.*s.out > curr_diff", namelen - ext_len, entry->d_name);
+                system(buf);
+                system("rm curr_out");
+                stat("curr_diff", &st);
+                if (st.st_size != 0) {
+                    printf("MISMATCH in %s\n", entry->d_name);
+                    break;
+                } else {
+                    printf("\t\033[1;32m SUCCESS \033[0m\n");
+                    system("rm curr_diff");
+                }
+                // Dominator-based and global, if there's a .dvnt.out/.gvn.out,
+                // the parallel LVN, which must give the same .out, and the
+                // streaming LVN, if there's a .stream.out
+                const char *flags[] = { "-dvnt", "-gvn", "-j 4", "-stream" };
+                const char *outs[] = { ".dvnt.out", ".gvn.out", ".out", ".stream.out" };
+                int failed = 0;
+                for (int i = 0; i < 4; ++i) {
+                    sprintf(buf, "./%.*s%s", namelen - ext_len, entry->d_name, outs[i]);
+                    if (access(buf, F_OK) == -1)
+                        continue;
+                    sprintf(buf, "../apply_lvn %s %s/%s > curr_out", flags[i], dir, entry->d_name);
+                    system(buf);
+                    sprintf(buf, "diff curr_out ./%.*s%s > curr_diff", namelen - ext_len, entry->d_name, outs[i]);
+                    system(buf);
+                    system("rm curr_out");
+                    stat("curr_diff", &st);
+                    if (st.st_size != 0) {
+                        printf("MISMATCH in %s (%s)\n", entry->d_name, flags[i]);
+                        failed = 1;
+                        break;
+                    } else {
+                        printf("\t\033[1;32m SUCCESS (%s) \033[0m\n", flags[i]);
+                        system("rm curr_diff");
+                    }
+                }
+                if (failed)
+                    break;
             }
         }
+        closedir(src);
     }
-    closedir(src);
 
     return(0);
 }
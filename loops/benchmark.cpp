@@ -0,0 +1,65 @@
+#include "havlak.h"
+#include "loop_info.h"
+
+/* Benchmark utilities */
+
+// Natural loops need the dominator tree, so we time LoopInfo with its
+// construction. Havlak's algorithm doesn't need it.
+static
+void loops_benchmark_comp(CFG cfg, int nelems) {
+ double li_time_taken, havlak_time_taken;
+ LoopInfo *li;
+ HavlakLoops *hl;
+ TIME_STMT(li = new LoopInfo(cfg), li_time_taken);
+ TIME_STMT(hl = new HavlakLoops(cfg), havlak_time_taken);
+
+ int num_irreducible = 0;
+ for (HavlakLoop &l : hl->loops) {
+   if (l.kind == HLOOP_KIND::IRREDUCIBLE) {
+     ++num_irreducible;
+   }
+ }
+ // Every natural loop is also found by Havlak's algorithm, and if there are
+ // no irreducible loops, the two forests must be the same.
+ LOOP(bb, 0, cfg.size()) {
+   assert(!li->is_header(bb) || hl->is_header(bb));
+   if (!num_irreducible) {
+     assert(li->loop_depth(bb) == hl->loop_depth(bb));
+   }
+ }
+
+ printf("Benchmark LoopInfo: %d elements: %.4lfs (%ld loops)\n", nelems,
+        li_time_taken, li->loops.len());
+ printf("Benchmark Havlak: %d elements: %.4lfs (%ld loops, %d irreducible)\n",
+        nelems, havlak_time_taken, hl->loops.len(), num_irreducible);
+
+ li->free();
+ hl->free();
+ delete li;
+ delete hl;
+}
+
+// Sizes up to `max_elems`. Some of the CFGs make the dominator tree
+// (and so LoopInfo) quadratic.
+static
+void loops_benchmark(const char *name, CFG (*gen)(int), int max_elems) {
+ int set[] = { 1000, 8000, 16000, 32000, 64000, 256000, 1000000 };
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   if (set[i] > max_elems)
+     break;
+   CFG cfg = gen(set[i]);
+   loops_benchmark_comp(cfg, set[i]);
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+int main() {
+  loops_benchmark("FwdBack", fwdback_cfg, 1000000);
+  loops_benchmark("ManyPred", manypred_cfg, 64000);
+  loops_benchmark("DeepLoops", deep_loops_cfg, 64000);
+  loops_benchmark("Irreducible", irreducible_cfg, 1000000);
+
+  return 0;
+}
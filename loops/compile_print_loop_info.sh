@@ -1 +1,2 @@
 g++ print_nat_loops.cpp -o print_nat_loops -Wall -Wno-unused-function
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
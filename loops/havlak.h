@@ -0,0 +1,377 @@
+#ifndef HAVLAK_H
+#define HAVLAK_H
+
+#include <stdio.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stefanos.h"
+
+/*
+Havlak's loop analysis ("Nesting of Reducible and Irreducible Loops", TOPLAS 1997).
+
+LoopInfo (loop_info.h) only finds natural loops, i.e. a back edge whose target
+dominates its source. Cycles that can be entered from more than one block
+(irreducible loops) are silently ignored. Havlak's algorithm finds both
+kinds, and nests them in a single forest. It doesn't need dominators:
+
+1) Number the blocks in DFS preorder. Then `w` is an ancestor of `v` in
+   the DFS tree iff pre(w) <= pre(v) <= last(w), where last(w) is the
+   largest preorder number in the subtree of `w`.
+2) Split the predecessors of every block in back preds (the pred is a
+   descendant of the block) and non-back preds.
+3) Visit the blocks in reverse preorder. A block `w` with back preds is a
+   loop header. The body is found walking backwards from the back preds over
+   the non-back preds. Every block (or inner loop) that is found is collapsed
+   into `w` with union-find, so that, later, an outer loop sees the whole
+   inner loop as `w`. If the walk reaches a block that is not a descendant
+   of `w`, then the loop has an entry other than `w` and it is irreducible.
+   In that case, the edge is moved to `w`, so that it is considered again
+   by the loops that enclose `w`.
+
+As Ramalingam notes ("Identifying Loops in Almost Linear Time", TOPLAS 1999),
+moving these edges is what can make the algorithm super-linear. Here we
+move an edge to `w` only if `w` doesn't already have an edge from the same
+representative (as most implementations do), which bounds the moved edges
+of a header by the number of distinct blocks that enter it. For reducible
+CFGs no edge is ever moved and the algorithm runs in almost linear time.
+
+For every loop we report its header, whether it's reducible, and its
+entries, i.e. the blocks of the loop that have a predecessor outside of
+it. A reducible loop has only one entry, its header.
+
+Unreachable blocks are ignored.
+*/
+
+#define NO_HLOOP -1
+
+enum class HLOOP_KIND {
+  REDUCIBLE,
+  IRREDUCIBLE,
+  // A block with a single self-loop and nothing else.
+  SELF,
+};
+
+typedef struct HavlakLoop {
+  int header_num;
+  HLOOP_KIND kind;
+  int parent;
+  Buf<int> children;
+  // 1 for outermost loops.
+  int depth;
+  // Blocks whose innermost loop is this one. The header is first.
+  Buf<int> bbs;
+  // Blocks of the loop with a predecessor outside of it.
+  Buf<int> entries;
+
+  void free() {
+    children.free();
+    bbs.free();
+    entries.free();
+  }
+} HavlakLoop;
+
+struct HavlakLoops {
+  Buf<HavlakLoop> loops;
+  // Innermost loop of every block or NO_HLOOP
+  Buf<int> innermost;
+  // Outermost loops, in increasing order of header.
+  Buf<int> top_level;
+
+  HavlakLoops(CFG cfg) {
+    int nbbs = cfg.size();
+    innermost.reserve_and_set(nbbs);
+    LOOP(i, 0, nbbs) {
+      innermost[i] = NO_HLOOP;
+    }
+
+    // All the arrays below are indexed by preorder number.
+    Buf<int> number;   // block -> preorder number (-1 if unreachable)
+    Buf<int> node;     // preorder number -> block
+    Buf<int> last;
+    int n = dfs(cfg, &number, &node, &last);
+
+    Buf<Buf<int>> back_preds, non_back_preds;
+    back_preds.reserve_and_set(n);
+    back_preds.initialize();
+    non_back_preds.reserve_and_set(n);
+    non_back_preds.initialize();
+    LOOP(w, 0, n) {
+      for (int pred : cfg.bbs[node[w]].preds) {
+        int v = number[pred];
+        if (v == -1)
+          continue;
+        if (w <= v && v <= last[w]) {
+          back_preds[w].push(v);
+        } else {
+          non_back_preds[w].push(v);
+        }
+      }
+    }
+
+    Buf<int> uf_parent;   // union-find
+    Buf<int> loop_of;     // preorder number of a header -> loop
+    Buf<int> pool_mark;   // == w if in the body of the loop of `w`
+    Buf<int> moved_mark;  // == w if an edge from it was moved to `w`
+    uf_parent.reserve_and_set(n);
+    loop_of.reserve_and_set(n);
+    pool_mark.reserve_and_set(n);
+    moved_mark.reserve_and_set(n);
+    LOOP(w, 0, n) {
+      uf_parent[w] = w;
+      loop_of[w] = NO_HLOOP;
+      pool_mark[w] = moved_mark[w] = -1;
+    }
+
+    Buf<int> node_pool;
+    LOOP_REV(w, 0, n) {
+      node_pool.clear();
+      bool self = false;
+      for (int v : back_preds[w]) {
+        if (v == w) {
+          self = true;
+          continue;
+        }
+        int vd = find(uf_parent, v);
+        if (pool_mark[vd] != w) {
+          pool_mark[vd] = w;
+          node_pool.push(vd);
+        }
+      }
+      if (!self && !node_pool.len())
+        continue;
+
+      HLOOP_KIND kind = node_pool.len() ? HLOOP_KIND::REDUCIBLE : HLOOP_KIND::SELF;
+      // `node_pool` is also the worklist; it only grows.
+      for (int i = 0; i < node_pool.len(); ++i) {
+        int x = node_pool[i];
+        for (int y : non_back_preds[x]) {
+          int yd = find(uf_parent, y);
+          if (!(w <= yd && yd <= last[w])) {
+            kind = HLOOP_KIND::IRREDUCIBLE;
+            if (moved_mark[yd] != w) {
+              moved_mark[yd] = w;
+              non_back_preds[w].push(yd);
+            }
+          } else if (yd != w && pool_mark[yd] != w) {
+            pool_mark[yd] = w;
+            node_pool.push(yd);
+          }
+        }
+      }
+
+      int l = loops.len();
+      HavlakLoop loop;
+      loop.header_num = node[w];
+      loop.kind = kind;
+      loop.parent = NO_HLOOP;
+      loop.depth = 0;
+      loop.bbs.push(node[w]);
+      loops.push(loop);
+      loop_of[w] = l;
+      innermost[node[w]] = l;
+      for (int x : node_pool) {
+        uf_parent[x] = w;
+        if (loop_of[x] != NO_HLOOP) {
+          loops[loop_of[x]].parent = l;
+        } else {
+          loops[l].bbs.push(node[x]);
+          innermost[node[x]] = l;
+        }
+      }
+    }
+
+    // Going over the headers in increasing order gives us the children
+    // and the top-level loops sorted by header.
+    LOOP(bb, 0, nbbs) {
+      if (!is_header(bb))
+        continue;
+      int l = innermost[bb];
+      int parent = loops[l].parent;
+      if (parent == NO_HLOOP) {
+        top_level.push(l);
+      } else {
+        loops[parent].children.push(l);
+      }
+    }
+    // Loops were created inner first, so we go in reverse
+    // to have the parents' depth ready.
+    LOOP_REV(l, 0, loops.len()) {
+      int parent = loops[l].parent;
+      loops[l].depth = (parent == NO_HLOOP) ? 1 : loops[parent].depth + 1;
+    }
+    compute_entries(cfg, number);
+
+    node_pool.free();
+    uf_parent.free();
+    loop_of.free();
+    pool_mark.free();
+    moved_mark.free();
+    for (Buf<int> &b : back_preds) {
+      b.free();
+    }
+    for (Buf<int> &b : non_back_preds) {
+      b.free();
+    }
+    back_preds.free();
+    non_back_preds.free();
+    number.free();
+    node.free();
+    last.free();
+  }
+
+  int loop_for(int bb) const {
+    return innermost[bb];
+  }
+
+  int loop_depth(int bb) const {
+    int l = innermost[bb];
+    return (l == NO_HLOOP) ? 0 : loops[l].depth;
+  }
+
+  bool is_header(int bb) const {
+    int l = innermost[bb];
+    return l != NO_HLOOP && loops[l].header_num == bb;
+  }
+
+  // Return true if loop `l` contains block `bb`. O(depth)
+  bool contains(int l, int bb) const {
+    for (int in = innermost[bb]; in != NO_HLOOP; in = loops[in].parent) {
+      if (in == l)
+        return true;
+      // Going up, we won't find `l` above its own depth.
+      if (loops[in].depth <= loops[l].depth)
+        return false;
+    }
+    return false;
+  }
+
+  void print() const {
+    for (int l : top_level) {
+      print_loop(l, 0);
+    }
+  }
+
+  void free() {
+    for (HavlakLoop &l : loops) {
+      l.free();
+    }
+    loops.free();
+    innermost.free();
+    top_level.free();
+  }
+
+private:
+
+  // Iterative DFS. Return the number of reachable blocks.
+  static
+  int dfs(CFG cfg, Buf<int> *number, Buf<int> *node, Buf<int> *last) {
+    int nbbs = cfg.size();
+    number->reserve_and_set(nbbs);
+    node->reserve_and_set(nbbs);
+    last->reserve_and_set(nbbs);
+    LOOP(i, 0, nbbs) {
+      (*number)[i] = -1;
+    }
+    struct Frame {
+      int bb;
+      int next_succ;
+    };
+    Buf<Frame> stack;
+    int counter = 0;
+    (*number)[0] = counter;
+    (*node)[counter++] = 0;
+    stack.push(Frame{0, 0});
+    while (stack.len()) {
+      Frame &f = stack[stack.len() - 1];
+      const Buf<int> &succs = cfg.bbs[f.bb].succs;
+      if (f.next_succ < succs.len()) {
+        int succ = succs[f.next_succ++];
+        if ((*number)[succ] == -1) {
+          (*number)[succ] = counter;
+          (*node)[counter++] = succ;
+          stack.push(Frame{succ, 0});
+        }
+        continue;
+      }
+      (*last)[(*number)[f.bb]] = counter - 1;
+      stack.pop_back();
+    }
+    stack.free();
+    return counter;
+  }
+
+  // Union-find with path halving.
+  static
+  int find(Buf<int> uf_parent, int x) {
+    while (uf_parent[x] != x) {
+      uf_parent[x] = uf_parent[uf_parent[x]];
+      x = uf_parent[x];
+    }
+    return x;
+  }
+
+  // For every edge p -> b, `b` is an entry of all the loops that
+  // contain `b` but not `p`.
+  void compute_entries(CFG cfg, Buf<int> number) {
+    Buf<int> entry_mark;
+    entry_mark.reserve_and_set(loops.len());
+    LOOP(l, 0, loops.len()) {
+      entry_mark[l] = -1;
+    }
+    LOOP(b, 0, cfg.size()) {
+      if (number[b] == -1)
+        continue;
+      for (int p : cfg.bbs[b].preds) {
+        if (number[p] == -1)
+          continue;
+        for (int l = innermost[b]; l != NO_HLOOP; l = loops[l].parent) {
+          if (contains(l, p))
+            break;
+          if (entry_mark[l] != b) {
+            entry_mark[l] = b;
+            loops[l].entries.push(b);
+          }
+        }
+      }
+    }
+    // The entry block of the procedure is entered from outside.
+    for (int l = innermost[0]; l != NO_HLOOP; l = loops[l].parent) {
+      if (entry_mark[l] != 0) {
+        loops[l].entries.push(0);
+      }
+    }
+    entry_mark.free();
+  }
+
+  void print_bbs(int l) const {
+    for (int bb_num : loops[l].bbs) {
+      printf("%%%d ", bb_num);
+    }
+    for (int child : loops[l].children) {
+      print_bbs(child);
+    }
+  }
+
+  void print_loop(int l, int indent) const {
+    const HavlakLoop &loop = loops[l];
+    const char *kind = "reducible";
+    if (loop.kind == HLOOP_KIND::IRREDUCIBLE) {
+      kind = "irreducible";
+    } else if (loop.kind == HLOOP_KIND::SELF) {
+      kind = "self";
+    }
+    printf("%*sLoop: %%%d (%s), entries:", indent, "", loop.header_num, kind);
+    for (int e : loop.entries) {
+      printf(" %%%d", e);
+    }
+    printf("\n");
+    printf("%*s  ", indent, "");
+    print_bbs(l);
+    printf("\n");
+    for (int child : loop.children) {
+      print_loop(child, indent + 2);
+    }
+  }
+};
+
+#endif
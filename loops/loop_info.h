@@ -10,99 +10,257 @@
 #include "../common/stefanos.h"
 #include "../dominance/dtree.h"
 
+#define NO_LOOP -1
+
+/*
+Natural loops, organized in a loop nesting forest.
+
+There is exactly one Loop per header; all the back edges to the same header
+(i.e. its latches) are merged in the same loop. Loops are referenced by their
+index in `LoopInfo::loops`.
+
+Every block knows its innermost loop (`LoopInfo::innermost`) and its loop depth
+(0 if it's not in any loop). A loop only keeps the blocks for which it is the
+innermost loop; the blocks of the nested loops are found through `children`.
+
+Membership is answered in constant time with intervals: the loops are
+numbered in preorder of the forest, so the loops nested in `L` (including `L`)
+have numbers in [pre(L), last(L)]. Then, `L` contains `bb` iff the innermost
+loop of `bb` is in that interval.
+*/
+
 typedef struct Loop {
   int header_num;
-  int latch_num;
+  Buf<int> latches;
+  int parent;
+  Buf<int> children;
+  // 1 for outermost loops.
+  int depth;
+  // Blocks whose innermost loop is this one. The header is first.
   Buf<int> bbs;
+  // Interval in the preorder of the loop forest.
+  int pre, last;
 
   Loop() {
-    header_num = latch_num = -1;
+    header_num = -1;
+    parent = NO_LOOP;
+    depth = 0;
+    pre = last = -1;
+  }
+
+  Loop(int _header_num) : Loop() {
+    header_num = _header_num;
+  }
+
+  void free() {
+    latches.free();
+    children.free();
+    bbs.free();
+  }
+} Loop;
+
+typedef struct LoopInfo {
+  Buf<Loop> loops;
+  // Innermost loop of every block or NO_LOOP
+  Buf<int> innermost;
+  // Loop depth of every block
+  Buf<int> depths;
+  // Outermost loops, in increasing order of header.
+  Buf<int> top_level;
+
+  LoopInfo(CFG cfg) {
+    DominatorTree dtree(cfg);
+    *this = LoopInfo(cfg, dtree);
+    dtree.free();
   }
 
-  Loop(int _header_num, int _latch_num) :
-    header_num(_header_num), latch_num(_latch_num) { }
+  /*
+  Like LLVM's LoopInfo: We visit the headers in reverse preorder of the dominator
+  tree, so that inner loops are discovered before outer loops. For each header,
+  we walk backwards from its latches. When the walk finds a block that is
+  already in a loop, it jumps to the outermost loop discovered so far that
+  contains it, makes it a child of the current loop and continues from the
+  predecessors of its header that are outside it. So, every block is
+  visited (approximately) once per loop that it's _directly_ in.
+  */
+  LoopInfo(CFG cfg, DominatorTree dtree) {
+    int nbbs = cfg.size();
+    ExplicitDomTree edt(dtree);
+    innermost.reserve_and_set(nbbs);
+    depths.reserve_and_set(nbbs);
+    LOOP(i, 0, nbbs) {
+      innermost[i] = NO_LOOP;
+      depths[i] = 0;
+    }
 
-  Loop(CFG cfg, int _header_num, int _latch_num) :
-    Loop(_header_num, _latch_num)
-  {
-    this->add(header_num);
     Stack<int> s;
+    LOOP_REV(i, 0, edt.preorder.len()) {
+      int header_num = edt.preorder[i];
+      int l = loops.len();
+      Loop loop(header_num);
+      for (int pred : cfg.bbs[header_num].preds) {
+        if (edt.dominates(header_num, pred)) {
+          loop.latches.push(pred);
+        }
+      }
+      if (!loop.latches.len())
+        continue;
+      loop.bbs.push(header_num);
+      loops.push(loop);
+      innermost[header_num] = l;
 
-    s.push(latch_num);
-    while (!s.empty()) {
-      int p = s.pop();
-      if (!this->contains(p)) {
-        this->add(p);
-        for (int pred : cfg.bbs[p].preds) {
-          s.push(pred);
+      LOOP_REV(j, 0, loops[l].latches.len()) {
+        s.push(loops[l].latches[j]);
+      }
+      while (!s.empty()) {
+        int p = s.pop();
+        if (!edt.is_reachable_from_entry(p))
+          continue;
+        int sub = innermost[p];
+        if (sub == NO_LOOP) {
+          innermost[p] = l;
+          loops[l].bbs.push(p);
+          for (int pred : cfg.bbs[p].preds) {
+            s.push(pred);
+          }
+          continue;
+        }
+        while (loops[sub].parent != NO_LOOP) {
+          sub = loops[sub].parent;
+        }
+        if (sub == l)
+          continue;
+        loops[sub].parent = l;
+        int sub_header = loops[sub].header_num;
+        for (int pred : cfg.bbs[sub_header].preds) {
+          if (!edt.dominates(sub_header, pred)) {
+            s.push(pred);
+          }
         }
       }
     }
     s.free();
-    this->bbs.compact();
-  }
+    edt.free();
 
-  bool contains(int bb_num) const {
-    for (int loop_bb_num : this->bbs) {
-      if (loop_bb_num == bb_num)
-        return true;
+    LOOP(l, 0, loops.len()) {
+      loops[l].bbs.compact();
+    }
+    // Going over the headers in increasing order gives us the children
+    // and the top-level loops sorted by header.
+    LOOP(bb, 0, nbbs) {
+      if (!is_header(bb))
+        continue;
+      int l = innermost[bb];
+      int parent = loops[l].parent;
+      if (parent == NO_LOOP) {
+        top_level.push(l);
+      } else {
+        loops[parent].children.push(l);
+      }
+    }
+    number_forest();
+    LOOP(bb, 0, nbbs) {
+      if (innermost[bb] != NO_LOOP) {
+        depths[bb] = loops[innermost[bb]].depth;
+      }
     }
-    return false;
   }
 
-  size_t size() const {
-    return bbs.len();
+  // Return the innermost loop of `bb` or NO_LOOP.
+  int loop_for(int bb) const {
+    return innermost[bb];
   }
 
-  void print() const {
-    printf("Loop: %%%d <- %%%d\n", header_num, latch_num);
-    printf("  ");
-    for (int bb_num : bbs) {
-      printf("%%%d ", bb_num);
-    }
-    printf("\n");
+  int loop_depth(int bb) const {
+    return depths[bb];
   }
 
-  void add(int bb_num) {
-    bbs.push(bb_num);
+  bool is_header(int bb) const {
+    int l = innermost[bb];
+    return l != NO_LOOP && loops[l].header_num == bb;
   }
 
-  void free() {
-    bbs.free();
+  // Return true if loop `l` contains block `bb`.
+  bool contains(int l, int bb) const {
+    int in = innermost[bb];
+    if (in == NO_LOOP)
+      return false;
+    return loops[l].pre <= loops[in].pre && loops[in].pre <= loops[l].last;
   }
-} Loop;
 
-typedef struct LoopInfo {
-  Buf<Loop> loops;
+  // Return true if loop `outer` contains (or is) loop `inner`.
+  bool contains_loop(int outer, int inner) const {
+    return loops[outer].pre <= loops[inner].pre &&
+           loops[inner].pre <= loops[outer].last;
+  }
 
-  LoopInfo(CFG cfg) {
-    DominatorTree dtree(cfg);
-    *this = LoopInfo(cfg, dtree);
-    dtree.free();
+  void print() const {
+    for (int l : top_level) {
+      print_loop(l, 0);
+    }
   }
 
-  LoopInfo(CFG cfg, DominatorTree dtree) {
-    LOOP(header_num, 0, cfg.size()) {
-      Buf<int> preds = cfg.bbs[header_num].preds;
-      for (int latch_num : preds) {
-        // TODO: With the current scheme, two loops
-        // can have the same header. We probably want to
-        // have a unique mapping from header to loop (and vice versa).
-        if (dtree.dominates(header_num, latch_num) &&
-            dtree.is_reachable_from_entry(latch_num)) {
-          Loop l(cfg, header_num, latch_num);
-          this->loops.push(l);
-        }
+  void free() {
+    for (Loop &l : loops) {
+      l.free();
+    }
+    loops.free();
+    innermost.free();
+    depths.free();
+    top_level.free();
+  }
+
+private:
+
+  // Assign depth, pre and last to every loop with an iterative
+  // DFS of the forest.
+  void number_forest() {
+    int counter = 0;
+    Stack<int> s;
+    LOOP_REV(i, 0, top_level.len()) {
+      s.push(top_level[i]);
+    }
+    while (!s.empty()) {
+      int l = s.pop();
+      if (l < 0) {
+        loops[~l].last = counter - 1;
+        continue;
+      }
+      Loop &loop = loops[l];
+      loop.depth = (loop.parent == NO_LOOP) ? 1 : loops[loop.parent].depth + 1;
+      loop.pre = counter++;
+      s.push(~l);
+      LOOP_REV(i, 0, loop.children.len()) {
+        s.push(loop.children[i]);
       }
     }
+    s.free();
   }
 
-  void print() const {
-    for (Loop l : loops) {
-      l.print();
+  // Print all the blocks of `l`, including those of the nested loops.
+  void print_bbs(int l) const {
+    for (int bb_num : loops[l].bbs) {
+      printf("%%%d ", bb_num);
+    }
+    for (int child : loops[l].children) {
+      print_bbs(child);
     }
   }
-} LoopInfo;
 
+  void print_loop(int l, int indent) const {
+    const Loop &loop = loops[l];
+    printf("%*sLoop: %%%d <- ", indent, "", loop.header_num);
+    LOOP(i, 0, loop.latches.len()) {
+      printf(i ? ", %%%d" : "%%%d", loop.latches[i]);
+    }
+    printf("\n");
+    printf("%*s  ", indent, "");
+    print_bbs(l);
+    printf("\n");
+    for (int child : loop.children) {
+      print_loop(child, indent + 2);
+    }
+  }
+} LoopInfo;
 
 #endif
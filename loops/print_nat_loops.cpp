@@ -3,12 +3,28 @@
 #include "../common/cfg.h"
 #include "../common/parser_ir.h"
 #include "../common/stefanos.h"
+#include "havlak.h"
 #include "loop_info.h"
 
+// Usage: print_nat_loops [-havlak] file
+// With -havlak, reducible and irreducible loops are found with
+// Havlak's algorithm instead of only the natural loops.
 int main(int argc, char **argv) {
-  assert(argc == 2);
-  CFG cfg = parse_procedure(argv[1], NULL);
-  LoopInfo li(cfg);
-  li.print();
+  assert(argc == 2 || argc == 3);
+  bool havlak = false;
+  if (argc == 3) {
+    assert(!strcmp(argv[1], "-havlak"));
+    havlak = true;
+  }
+  CFG cfg = parse_procedure(argv[argc - 1], NULL);
+  if (havlak) {
+    HavlakLoops hl(cfg);
+    hl.print();
+    hl.free();
+  } else {
+    LoopInfo li(cfg);
+    li.print();
+    li.free();
+  }
   cfg.destruct();
 }
@@ -63,6 +63,23 @@ int main()
                 printf("\t\033[1;32m SUCCESS \033[0m\n");
                 system("rm curr_diff");
             }
+            // Havlak loops, if there's a .havlak.out
+            sprintf(buf, "./%.*s.havlak.out", namelen - ext_len, entry->d_name);
+            if (access(buf, F_OK) == -1)
+                continue;
+            sprintf(buf, "../print_nat_loops -havlak %s/%s > curr_out", dir, entry->d_name);
+            system(buf);
+            sprintf(buf, "diff curr_out ./%.*s.havlak.out > curr_diff", namelen - ext_len, entry->d_name);
+            system(buf);
+            system("rm curr_out");
+            stat("curr_diff", &st);
+            if (st.st_size != 0) {
+                printf("MISMATCH in %s (-havlak)\n", entry->d_name);
+                break;
+            } else {
+                printf("\t\033[1;32m SUCCESS (-havlak) \033[0m\n");
+                system("rm curr_diff");
+            }
         }
     }
     closedir(src);
@@ -0,0 +1,249 @@
+#include "../live_information/live_points.h"
+#include "../loops/havlak.h"
+#include "../common/interpreter.h"
+#include "interference.h"
+#include "linear_scan.h"
+#include "live_intervals.h"
+
+/* Benchmark utilities */
+
+// Every instruction's live-before set must be what the intervals say at
+// its use position.
+static
+void check_intervals(CFG cfg, const LiveIntervals &li, const LiveInfo &live) {
+ Buf<BitSet> after;
+ for (int bb : li.order) {
+   int ninsts = cfg.bbs[bb].insts.num_nodes();
+   after.clear();
+   LOOP(i, 0, ninsts) {
+     after.push(bset(live.num_registers));
+   }
+   live_annotate_block(cfg.bbs[bb], live.LiveOut[bb], after);
+   LOOP(r, 0, live.num_registers) {
+     assert(live.is_live_in(bb, r) == li.is_live_at(r, li.block_from[bb]));
+     LOOP(i, 1, ninsts) {
+       int pos = li.block_from[bb] + 2 * (i + 1);
+       assert(bset_is_in(after[i - 1], r) == li.is_live_at(r, pos));
+     }
+   }
+   for (BitSet s : after) {
+     bset_free(s);
+   }
+ }
+ after.free();
+}
+
+// `liveness()` alone against the intervals (which include it) and the
+// per-loop pressure. The flat layout is compared, in bytes, with a set
+// per instruction.
+static
+void intervals_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 16000, 64000, 256000 };
+ int nregs = 64, ninsts = 8;
+ printf("--- %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   CFG cfg = gen(set[i]);
+   srand(set[i]);
+   populate_cfg(cfg, nregs, ninsts);
+   double live_time_taken, li_time_taken, loops_time_taken, query_time_taken;
+   LiveInfo live;
+   LiveIntervals li;
+   TIME_STMT(live = liveness(cfg, nregs - 1), live_time_taken);
+   TIME_STMT(li = live_intervals(cfg, nregs - 1), li_time_taken);
+   HavlakLoops hl(cfg);
+   Buf<int> peak;
+   TIME_STMT(peak = loop_peak_pressure(li, hl), loops_time_taken);
+   int live_count = 0;
+   TIME_STMT(
+     LOOP(r, 0, nregs) {
+       for (int pos = 0; pos < li.num_positions; pos += 2) {
+         live_count += li.is_live_at(r, pos);
+       }
+     }, query_time_taken);
+   if (set[i] <= 16000) {
+     check_intervals(cfg, li, live);
+   }
+
+   size_t flat_bytes = li.range_offsets.len() * sizeof(int) +
+     li.ranges.len() * sizeof(LiveRange) + li.use_offsets.len() * sizeof(int) +
+     li.uses.len() * sizeof(int);
+   size_t per_inst_bytes = (size_t) (li.num_positions / 2) *
+     num_words(nregs) * sizeof(BitSet64);
+   int max_peak = 0;
+   for (int p : peak) {
+     max_peak = MAX(max_peak, p);
+   }
+
+   printf("Benchmark Liveness: %d elements: %.4lfs\n", set[i], live_time_taken);
+   printf("Benchmark Intervals: %d elements: %.4lfs (%ld ranges, %ld uses, "
+          "%zu bytes vs %zu for a set per instruction)\n",
+          set[i], li_time_taken, li.ranges.len(), li.uses.len(),
+          flat_bytes, per_inst_bytes);
+   printf("Benchmark Loop Pressure: %d elements: %.4lfs (%ld loops, max peak %d)\n",
+          set[i], loops_time_taken, hl.loops.len(), max_peak);
+   printf("Benchmark Queries: %d elements: %.4lfs (%d live)\n",
+          set[i], query_time_taken, live_count);
+   peak.free();
+   hl.free();
+   li.free();
+   live.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// Like populate_cfg(), but for a chain of blocks (e.g. FwdBack) with short
+// live ranges, like in real code, so that the number of registers can grow
+// without the graph becoming dense. The block `b` first defines its own
+// `step` = nregs / (number of blocks) registers and then only uses the
+// registers defined in the last `window` / `step` blocks. A quarter of
+// the DEFs are copies.
+static
+void populate_cfg_window(CFG cfg, int nregs, int ninsts, int window) {
+ int nbbs = cfg.size();
+ int step = nregs / nbbs;
+ assert(step > 0 && window >= step);
+ for (BasicBlock &bb : cfg.bbs) {
+   int base = bb.num * step;
+   int lo = MAX(0, base + step - window);
+   auto reg = [&]() { return lo + rand() % (base + step - lo); };
+   LOOP(r, base, base + step) {
+     bb.insert_inst_at_end(Instruction::def(r, op_simple(val_imm(rand() % 100))));
+   }
+   LOOP(i, 0, ninsts) {
+     Value lhs = (rand() % 4) ? val_reg(reg()) : val_imm(rand() % 100);
+     if (rand() % 2) {
+       bb.insert_inst_at_end(Instruction::print(op_simple(lhs)));
+       continue;
+     }
+     Operation op = op_simple(lhs);
+     if (rand() % 2) {
+       op = op_add(lhs, val_reg(reg()));
+     }
+     bb.insert_inst_at_end(Instruction::def(reg(), op));
+   }
+   switch (bb.succs.len()) {
+   case 0:
+     break;
+   case 1:
+     bb.insert_inst_at_end(Instruction::br_uncond(bb.succs[0]));
+     break;
+   case 2:
+     bb.insert_inst_at_end(Instruction::br_cond(val_reg(reg()),
+                                                bb.succs[0], bb.succs[1]));
+     break;
+   default:
+     assert(0);
+   }
+ }
+}
+
+// The matrix grows with the square of the registers and the adjacency
+// vectors with the edges.
+static
+void interference_benchmark(void) {
+ int set[] = { 10000, 25000, 50000, 100000 };
+ int ninsts = 16, window = 32;
+ printf("--- Interference Graph FwdBack ---\n");
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   int nregs = set[i];
+   CFG cfg = fwdback_cfg(nregs / 4);
+   srand(nregs);
+   populate_cfg_window(cfg, nregs, ninsts, window);
+   double live_time_taken, ig_time_taken, moves_time_taken;
+   LiveInfo live;
+   InterferenceGraph ig, igm;
+   TIME_STMT(live = liveness(cfg, nregs - 1), live_time_taken);
+   TIME_STMT(ig = interference_graph(cfg, live), ig_time_taken);
+   TIME_STMT(igm = interference_graph(cfg, live, true), moves_time_taken);
+
+   size_t degrees = 0;
+   LOOP(r, 0, nregs) {
+     degrees += ig.degree(r);
+     for (int n : ig.adj[r]) {
+       assert(ig.interfere(r, n) && ig.interfere(n, r));
+     }
+   }
+   assert(degrees == 2 * ig.num_edges);
+   assert(igm.num_edges <= ig.num_edges);
+
+   printf("Benchmark Liveness: %d registers: %.4lfs\n", nregs, live_time_taken);
+   printf("Benchmark Interference: %d registers: %.4lfs (%zu edges, "
+          "%zu matrix bytes, %zu adjacency bytes)\n", nregs, ig_time_taken,
+          ig.num_edges, ig.matrix_bytes(), ig.adj_bytes());
+   printf("Benchmark Interference (moves): %d registers: %.4lfs (%zu edges, "
+          "%ld moves)\n", nregs, moves_time_taken, igm.num_edges, igm.moves.len());
+   igm.free();
+   ig.free();
+   live.free();
+   cfg.destruct();
+ }
+ printf("\n");
+}
+
+// The whole pipeline: intervals (with liveness), LoopInfo (with the
+// dominator tree), the scan and the rewriting. The allocated code is
+// executed and compared with the original.
+static
+void linear_scan_benchmark(const char *name, CFG (*gen)(int)) {
+ int set[] = { 1000, 16000, 64000 };
+ int ks[] = { 8, 16 };
+ int nregs = 64, ninsts = 8;
+ int64_t max_steps = 1000000;
+ printf("--- Linear Scan %s ---\n", name);
+ LOOP(i, 0, (int) ARR_LEN(set)) {
+   LOOP(j, 0, (int) ARR_LEN(ks)) {
+     int k = ks[j];
+     CFG orig = gen(set[i]);
+     srand(set[i]);
+     populate_cfg(orig, nregs, ninsts);
+     CFG cfg = gen(set[i]);
+     srand(set[i]);
+     populate_cfg(cfg, nregs, ninsts);
+
+     double li_time_taken, loops_time_taken, assign_time_taken, rewrite_time_taken;
+     LiveIntervals li;
+     LoopInfo *loops;
+     Allocation alloc;
+     TIME_STMT(li = live_intervals(cfg, nregs - 1), li_time_taken);
+     TIME_STMT(loops = new LoopInfo(cfg), loops_time_taken);
+     TIME_STMT(alloc = linear_scan_assign(cfg, li, *loops, k), assign_time_taken);
+     TIME_STMT(linear_scan_rewrite(cfg, &alloc), rewrite_time_taken);
+
+     InterpResult before = interpret(orig, nregs - 1, max_steps);
+     InterpResult after = interpret(cfg, alloc.max_register(), max_steps);
+     assert(same_output(before, after));
+
+     printf("Benchmark Linear Scan: %d elements, K = %d: %.4lfs "
+            "(intervals %.4lfs, loops %.4lfs, scan %.4lfs, rewrite %.4lfs)\n",
+            set[i], k, li_time_taken + loops_time_taken + assign_time_taken +
+            rewrite_time_taken, li_time_taken, loops_time_taken,
+            assign_time_taken, rewrite_time_taken);
+     printf("  %d spilled, %d reloads, %d stores; %.2lf instructions executed "
+            "per value printed (%.2lf without spill code)\n",
+            alloc.num_spilled(), alloc.reloads, alloc.stores,
+            (double) after.steps / MAX(after.output.len(), 1),
+            (double) before.steps / MAX(before.output.len(), 1));
+     before.free();
+     after.free();
+     alloc.free();
+     loops->free();
+     delete loops;
+     li.free();
+     cfg.destruct();
+     orig.destruct();
+   }
+ }
+ printf("\n");
+}
+
+int main() {
+  intervals_benchmark("FwdBack", fwdback_cfg);
+  intervals_benchmark("DeepLoops", deep_loops_cfg);
+  intervals_benchmark("Irreducible", irreducible_cfg);
+  interference_benchmark();
+  linear_scan_benchmark("FwdBack", fwdback_cfg);
+  linear_scan_benchmark("DeepLoops", deep_loops_cfg);
+
+  return 0;
+}
@@ -0,0 +1,4 @@
+g++ print_intervals.cpp -o print_intervals -Wall -Wno-unused-function
+g++ print_interference.cpp -o print_interference -Wall -Wno-unused-function
+g++ print_allocation.cpp -o print_allocation -Wall -Wno-unused-function
+g++ benchmark.cpp -o benchmark -Wall -Wno-unused-function -O3
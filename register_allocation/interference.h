@@ -0,0 +1,251 @@
+#ifndef INTERFERENCE_H
+#define INTERFERENCE_H
+
+#include <stdio.h>
+#include <string.h>
+#include "../common/stefanos.h"
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../live_information/liveout.h"
+
+/*
+Interference graph (Chaitin; the representation is from Briggs, Cooper &
+Torczon, "Improvements to Graph Coloring Register Allocation").
+
+Two registers interfere if one is defined while the other is live. So, we
+walk every block backwards starting from its LiveOut and, at every DEF of
+`d`, we add an edge from `d` to every register live right after it (even
+if `d` itself is dead after it; the definition still writes a register).
+
+The graph is kept twice:
+- A triangular bit matrix, for O(1) `interfere(a, b)` and to avoid
+  duplicate edges. It takes n * (n - 1) / 2 bits for n registers, so for
+  sparse register names compact them first (see reg_compaction.h).
+- An adjacency vector per register, for iterating over the neighbors
+  (e.g. to compute degrees or to simplify while coloring).
+
+Move-aware mode: For a copy `%a <- %b`, `%a` and `%b` hold the same value,
+so they don't need to interfere because of it and they are candidates for
+coalescing. In that mode we don't add the edge `(%a, %b)` at the copy (it
+is still added if they interfere somewhere else) and we record the copy in
+`moves`.
+
+During the walk, the live set is a sparse set (Briggs & Torczon, "An
+Efficient Representation for Sparse Sets"), so that adding the edges of a
+definition is O(live registers) and not O(registers) like with a bitset.
+
+Registers that are used before they're defined (i.e. live-in at the entry)
+only interfere with what's defined while they're live.
+*/
+
+typedef struct RegMove {
+  int dst, src;
+} RegMove;
+
+typedef struct InterferenceGraph {
+  int num_registers;
+  // The triangular matrix, row by row: The pair (a, b), a > b, is the bit
+  // a * (a - 1) / 2 + b.
+  Buf<BitSet64> matrix;
+  Buf<Buf<int>> adj;
+  // Only in move-aware mode.
+  Buf<RegMove> moves;
+  size_t num_edges;
+
+  bool interfere(int a, int b) const {
+    if (a == b)
+      return false;
+    size_t bit = index(a, b);
+    return (matrix[bit / WORD_SIZE] >> (bit % WORD_SIZE)) & 1;
+  }
+
+  // Returns false if the edge was already there.
+  bool add_edge(int a, int b) {
+    assert(a != b);
+    size_t bit = index(a, b);
+    BitSet64 mask = (BitSet64) 1 << (bit % WORD_SIZE);
+    if (matrix[bit / WORD_SIZE] & mask)
+      return false;
+    matrix[bit / WORD_SIZE] |= mask;
+    adj[a].push(b);
+    adj[b].push(a);
+    ++num_edges;
+    return true;
+  }
+
+  int degree(int r) const {
+    return adj[r].len();
+  }
+
+  size_t matrix_bytes() const {
+    return matrix.len() * sizeof(BitSet64);
+  }
+
+  size_t adj_bytes() const {
+    size_t res = adj.len() * sizeof(Buf<int>);
+    for (const Buf<int> &a : adj) {
+      res += a.cap * sizeof(int);
+    }
+    return res;
+  }
+
+  // The neighbors of every register, in increasing order, and the moves.
+  void print(const uint32_t *reg_names = NULL) const {
+    LOOP(r, 0, num_registers) {
+      if (!degree(r))
+        continue;
+      printf("%%%u:", reg_names ? reg_names[r] : r);
+      // Go over the row with the matrix, so that it's sorted.
+      LOOP(n, 0, num_registers) {
+        if (interfere(r, n)) {
+          printf(" %%%u", reg_names ? reg_names[n] : n);
+        }
+      }
+      printf("\n");
+    }
+    for (RegMove m : moves) {
+      printf("Move: %%%u <- %%%u\n", reg_names ? reg_names[m.dst] : m.dst,
+             reg_names ? reg_names[m.src] : m.src);
+    }
+  }
+
+  void free() {
+    matrix.free();
+    for (Buf<int> &a : adj) {
+      a.free();
+    }
+    adj.free();
+    moves.free();
+  }
+
+private:
+  static size_t index(int a, int b) {
+    if (a < b) {
+      int tmp = a;
+      a = b;
+      b = tmp;
+    }
+    return (size_t) a * (a - 1) / 2 + b;
+  }
+} InterferenceGraph;
+
+// Briggs & Torczon's sparse set over [0, n): `dense` has the members in
+// insertion order and `sparse[r]` is the index of `r` in it (if it's a
+// member). Clearing is O(1). `sparse` is never initialized, hence the
+// unsigned comparison in `is_in()`.
+typedef struct SparseSet {
+  Buf<int> dense, sparse;
+  int size;
+
+  SparseSet(int n) {
+    dense.reserve_and_set(n);
+    sparse.reserve_and_set(n);
+    size = 0;
+  }
+
+  bool is_in(int r) const {
+    unsigned i = sparse[r];
+    return i < (unsigned) size && dense[i] == r;
+  }
+
+  void add(int r) {
+    if (is_in(r))
+      return;
+    sparse[r] = size;
+    dense[size++] = r;
+  }
+
+  void remove(int r) {
+    if (!is_in(r))
+      return;
+    int last = dense[--size];
+    dense[sparse[r]] = last;
+    sparse[last] = sparse[r];
+  }
+
+  void clear() {
+    size = 0;
+  }
+
+  void free() {
+    dense.free();
+    sparse.free();
+  }
+} SparseSet;
+
+static
+InterferenceGraph interference_graph(CFG cfg, const LiveInfo &live,
+                                     bool move_aware = false) {
+  InterferenceGraph ig;
+  int n = live.num_registers;
+  ig.num_registers = n;
+  ig.num_edges = 0;
+  size_t bits = (size_t) n * (n - 1) / 2;
+  size_t words = (bits + WORD_SIZE - 1) / WORD_SIZE;
+  ig.matrix.reserve_and_set(words);
+  memset(ig.matrix.data, 0, words * sizeof(BitSet64));
+  ig.adj.reserve_and_set(n);
+  ig.adj.initialize();
+
+  SparseSet live_now(n);
+  auto use = [&live_now](Value v) {
+    if (val_kind(v) == VAL_REG) {
+      live_now.add(val_strip_kind(v));
+    }
+  };
+  for (BasicBlock &bb : cfg.bbs) {
+    live_now.clear();
+    BitSet LiveOut = live.LiveOut[bb.num];
+    LOOPu32(w, 0, num_words(n)) {
+      BitSet64 word = LiveOut.data[w];
+      while (word) {
+        live_now.add(w * WORD_SIZE + __builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+    for (auto *node = bb.insts.tail; node; node = node->prev) {
+      Instruction *inst = (Instruction *) node;
+      switch (inst->kind) {
+      case INST::DEF:
+      {
+        int d = inst->reg;
+        int copy_src = -1;
+        if (inst->op.kind == OP_SIMPLE && val_kind(inst->op.lhs) == VAL_REG) {
+          copy_src = val_strip_kind(inst->op.lhs);
+        }
+        if (move_aware && copy_src != -1 && copy_src != d) {
+          ig.moves.push(RegMove{d, copy_src});
+        } else {
+          copy_src = -1;
+        }
+        LOOP(i, 0, live_now.size) {
+          int r = live_now.dense[i];
+          if (r != d && r != copy_src) {
+            ig.add_edge(d, r);
+          }
+        }
+        live_now.remove(d);
+        use(inst->op.lhs);
+        if (inst->op.kind == OP_ADD) {
+          use(inst->op.rhs);
+        }
+      } break;
+      case INST::PRINT:
+        use(inst->op.lhs);
+        break;
+      case INST::BR_COND:
+        use(inst->cond_val);
+        break;
+      case INST::BR_UNCOND:
+        break;
+      default:
+        assert(0);
+      }
+    }
+  }
+  live_now.free();
+  return ig;
+}
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef LINEAR_SCAN_H
+#define LINEAR_SCAN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/stefanos.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../loops/loop_info.h"
+#include "live_intervals.h"
+
+/*
+Linear scan register allocation - Poletto & Sarkar.
+
+An end-to-end client of the analyses: The live intervals (see
+live_intervals.h, which need liveness) and the loop nesting (LoopInfo,
+which needs the dominator tree).
+
+1) Every register gets the lifetime [start, end) that covers all of its
+   live ranges in the linear order.
+2) Spill weights: Every definition and use of a register counts
+   10^(loop depth of its block) and the sum is divided by the length of the
+   lifetime. So, registers that are used a lot in inner loops are kept and
+   long-lived registers that are rarely used are spilled.
+3) The scan: The lifetimes are visited in increasing start, keeping the
+   `active` ones (those that hold a physical register) sorted by end. Before
+   a lifetime gets a register, the active ones that ended are expired. If
+   there's no free register, the lifetime with the smallest weight among the
+   active ones and the current one is spilled (if it's an active one, the
+   current takes its register).
+4) Rewriting: The IR has no memory, so the spill slots are registers too:
+   After the allocation, registers [0, K) are the physical ones and
+   [K, K + number of slots) the spill slots. Two of the K physical registers
+   are kept as scratch registers for the spill code: A spilled operand is
+   reloaded (`%scratch <- %slot`) right before the instruction, and a
+   spilled definition is written to a scratch register and stored
+   (`%slot <- %scratch`) right after it.
+
+The result is IR again, so it can be printed, parsed and executed (see
+common/interpreter.h).
+
+Registers that only appear in unreachable blocks have no lifetime. They're
+replaced by a scratch register, since that code never runs. Like liveness,
+this doesn't handle PHIs.
+*/
+
+// The physical registers that are never allocated.
+#define LSCAN_NUM_SCRATCH 2
+
+typedef struct Allocation {
+  int k;
+  // The physical register of every (virtual) register or -1.
+  Buf<int> phys;
+  // The spill slot of every register or -1. A register with neither
+  // has no lifetime.
+  Buf<int> slot;
+  int num_slots;
+  // Spill code inserted.
+  int reloads, stores;
+
+  // The max register of the rewritten code.
+  int max_register() const {
+    return k + num_slots - 1;
+  }
+
+  int num_spilled() const {
+    return num_slots;
+  }
+
+  void free() {
+    phys.free();
+    slot.free();
+  }
+} Allocation;
+
+typedef struct LScanInterval {
+  int reg;
+  int start, end;
+} LScanInterval;
+
+static
+int lscan_compare(const void *a, const void *b) {
+  const LScanInterval *x = (const LScanInterval *) a;
+  const LScanInterval *y = (const LScanInterval *) b;
+  if (x->start != y->start)
+    return (x->start > y->start) - (x->start < y->start);
+  return (x->reg > y->reg) - (x->reg < y->reg);
+}
+
+// Spill weight of every register (see above).
+static
+Buf<double> lscan_weights(CFG cfg, const LiveIntervals &li, const LoopInfo &loops) {
+  Buf<double> weight;
+  weight.reserve_and_set(li.num_registers);
+  memset(weight.data, 0, li.num_registers * sizeof(double));
+  auto add = [&weight](Value v, double w) {
+    if (val_kind(v) == VAL_REG) {
+      weight[val_strip_kind(v)] += w;
+    }
+  };
+  for (int bb : li.order) {
+    double w = 1;
+    LOOP(d, 0, MIN(loops.loop_depth(bb), 8)) {
+      w *= 10;
+    }
+    for (Instruction *inst : cfg.bbs[bb].insts) {
+      switch (inst->kind) {
+      case INST::DEF:
+        weight[inst->reg] += w;
+        // Fallthrough
+      case INST::PRINT:
+        add(inst->op.lhs, w);
+        if (inst->op.kind == OP_ADD) {
+          add(inst->op.rhs, w);
+        }
+        break;
+      case INST::BR_COND:
+        add(inst->cond_val, w);
+        break;
+      case INST::BR_UNCOND:
+        break;
+      default:
+        assert(0);
+      }
+    }
+  }
+  LOOP(r, 0, li.num_registers) {
+    if (li.num_ranges(r)) {
+      weight[r] /= li.end(r) - li.start(r);
+    }
+  }
+  return weight;
+}
+
+// Assign a physical register or a spill slot to every register with a
+// lifetime. Doesn't change the code.
+static
+Allocation linear_scan_assign(CFG cfg, const LiveIntervals &li,
+                              const LoopInfo &loops, int k) {
+  assert(k > LSCAN_NUM_SCRATCH);
+  int navail = k - LSCAN_NUM_SCRATCH;
+  int nregs = li.num_registers;
+  Allocation alloc;
+  alloc.k = k;
+  alloc.num_slots = 0;
+  alloc.reloads = alloc.stores = 0;
+  alloc.phys.reserve_and_set(nregs);
+  alloc.slot.reserve_and_set(nregs);
+  LOOP(r, 0, nregs) {
+    alloc.phys[r] = alloc.slot[r] = -1;
+  }
+
+  Buf<double> weight = lscan_weights(cfg, li, loops);
+
+  Buf<LScanInterval> intervals;
+  LOOP(r, 0, nregs) {
+    if (li.num_ranges(r)) {
+      intervals.push(LScanInterval{r, li.start(r), li.end(r)});
+    }
+  }
+  qsort(intervals.data, intervals.len(), sizeof(LScanInterval), lscan_compare);
+
+  // Sorted by end. It has at most `navail` elements, so we keep it sorted
+  // with insertion.
+  Buf<LScanInterval> active;
+  Buf<int> free_regs;
+  LOOP_REV(p, 0, navail) {
+    free_regs.push(p);
+  }
+  auto insert_active = [&active](LScanInterval it) {
+    active.push(it);
+    int i = active.len() - 1;
+    while (i > 0 && active[i - 1].end > it.end) {
+      active[i] = active[i - 1];
+      --i;
+    }
+    active[i] = it;
+  };
+  for (LScanInterval it : intervals) {
+    // Expire
+    int expired = 0;
+    while (expired < active.len() && active[expired].end <= it.start) {
+      free_regs.push(alloc.phys[active[expired].reg]);
+      ++expired;
+    }
+    if (expired) {
+      LOOP(i, expired, active.len()) {
+        active[i - expired] = active[i];
+      }
+      active.resize(active.len() - expired);
+    }
+
+    if (free_regs.len()) {
+      alloc.phys[it.reg] = free_regs.back();
+      free_regs.pop_back();
+      insert_active(it);
+      continue;
+    }
+    // Spill the lightest of the active ones and the current one. On a tie,
+    // the one that ends last (like Poletto & Sarkar).
+    int victim = -1;
+    LOOP(i, 0, active.len()) {
+      int r = active[i].reg;
+      if (victim == -1 || weight[r] < weight[active[victim].reg] ||
+          (weight[r] == weight[active[victim].reg] &&
+           active[i].end > active[victim].end)) {
+        victim = i;
+      }
+    }
+    if (victim == -1 || weight[it.reg] < weight[active[victim].reg] ||
+        (weight[it.reg] == weight[active[victim].reg] &&
+         it.end >= active[victim].end)) {
+      alloc.slot[it.reg] = alloc.num_slots++;
+      continue;
+    }
+    int spilled = active[victim].reg;
+    alloc.phys[it.reg] = alloc.phys[spilled];
+    alloc.phys[spilled] = -1;
+    alloc.slot[spilled] = alloc.num_slots++;
+    LOOP(i, victim + 1, active.len()) {
+      active[i - 1] = active[i];
+    }
+    active.pop_back();
+    insert_active(it);
+  }
+  active.free();
+  free_regs.free();
+  intervals.free();
+  weight.free();
+  return alloc;
+}
+
+// Rewrite `cfg` in place with the allocation, inserting the spill code.
+static
+void linear_scan_rewrite(CFG cfg, Allocation *alloc) {
+  int k = alloc->k;
+  int scratch[LSCAN_NUM_SCRATCH] = { k - 2, k - 1 };
+  auto slot_reg = [alloc, k](int r) {
+    return (uint32_t) (k + alloc->slot[r]);
+  };
+  for (BasicBlock &bb : cfg.bbs) {
+    for (auto *n = bb.insts.head; n; n = n->next) {
+      Instruction *inst = (Instruction *) n;
+      // The registers reloaded for this instruction, so that a register
+      // used twice is reloaded once.
+      int reloaded[LSCAN_NUM_SCRATCH] = { -1, -1 };
+      int nreloaded = 0;
+      auto map_use = [&](Value *v) {
+        if (val_kind(*v) != VAL_REG)
+          return;
+        int r = val_strip_kind(*v);
+        if (alloc->phys[r] != -1) {
+          *v = val_reg(alloc->phys[r]);
+          return;
+        }
+        if (alloc->slot[r] == -1) {
+          *v = val_reg(scratch[0]);
+          return;
+        }
+        LOOP(i, 0, nreloaded) {
+          if (reloaded[i] == r) {
+            *v = val_reg(scratch[i]);
+            return;
+          }
+        }
+        assert(nreloaded < LSCAN_NUM_SCRATCH);
+        int s = nreloaded++;
+        reloaded[s] = r;
+        Instruction *reload = Instruction::def(scratch[s], op_simple(val_reg(slot_reg(r))));
+        reload->set_parent(&bb);
+        inst->insert_before(reload);
+        ++alloc->reloads;
+        *v = val_reg(scratch[s]);
+      };
+      switch (inst->kind) {
+      case INST::DEF:
+      {
+        map_use(&inst->op.lhs);
+        if (inst->op.kind == OP_ADD) {
+          map_use(&inst->op.rhs);
+        }
+        int r = inst->reg;
+        if (alloc->phys[r] != -1) {
+          inst->reg = alloc->phys[r];
+        } else if (alloc->slot[r] == -1) {
+          inst->reg = scratch[0];
+        } else {
+          inst->reg = scratch[0];
+          Instruction *store = Instruction::def(slot_reg(r), op_simple(val_reg(scratch[0])));
+          store->set_parent(&bb);
+          inst->insert_after(store);
+          ++alloc->stores;
+          // Skip the store.
+          n = n->next;
+        }
+      } break;
+      case INST::PRINT:
+        map_use(&inst->op.lhs);
+        break;
+      case INST::BR_COND:
+        map_use(&inst->cond_val);
+        break;
+      case INST::BR_UNCOND:
+        break;
+      default:
+        assert(0);
+      }
+    }
+  }
+}
+
+// Allocate `k` physical registers to `cfg` and rewrite it. Registers
+// [0, k) of the result are the physical ones and the rest spill slots.
+static
+Allocation linear_scan(CFG cfg, int max_register, int k) {
+  LiveIntervals li = live_intervals(cfg, max_register);
+  LoopInfo loops(cfg);
+  Allocation alloc = linear_scan_assign(cfg, li, loops, k);
+  loops.free();
+  li.free();
+  linear_scan_rewrite(cfg, &alloc);
+  return alloc;
+}
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef LIVE_INTERVALS_H
+#define LIVE_INTERVALS_H
+
+#include <stdio.h>
+#include <string.h>
+#include "../common/stefanos.h"
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/traversal.h"
+#include "../live_information/liveout.h"
+#include "../loops/havlak.h"
+
+/*
+Live intervals, for linear-scan style consumers (Poletto & Sarkar, "Linear
+Scan Register Allocation"; Wimmer & Franz, "Linear Scan Register Allocation
+on SSA Form").
+
+1) Linearization: The reachable blocks are laid out in RPO. Every block
+   gets a slot for its label and then one per instruction. Slot `k` has two
+   positions: 2k, where the instruction reads its operands, and 2k + 1,
+   where it writes its result. A block covers the positions
+   [from(b), to(b)), from its label to the end of its last instruction.
+2) Intervals: A register's interval is a sorted list of disjoint ranges
+   [start, end) plus the positions where it's used. We build them
+   backwards, block by block (in reverse linear order), starting from
+   LiveOut (see `liveness()`): A register that is live-out is live until
+   to(b). Going backwards over the instructions, a use at slot `k` makes
+   the register live until 2k + 1 (if it wasn't already) and a definition
+   ends the current range at 2k + 1 (a definition that is never used gets
+   [2k + 1, 2k + 2)). Whatever is still live at the top of the block is
+   live from from(b). Since registers are not in SSA form, a register can
+   have many definitions and so many ranges, even in the same block.
+   Adjacent ranges (e.g. across a fallthrough) are merged.
+
+   So, a register whose last use is at slot `k` and one defined at `k` don't
+   overlap and can share a machine register.
+
+3) Pressure: The number of live registers at every position, with a sweep
+   over the range boundaries. We report the peak of every block and, with
+   the loop forest (HavlakLoops, so that irreducible loops are included),
+   of every loop (including its nested loops).
+
+The result is flat: The ranges of all the registers are in one array
+(CSR: the ranges of `r` are `ranges[range_offsets[r] .. range_offsets[r+1])`),
+and so are the uses. They are bucketed from a single list of (register,
+range) pairs with a counting sort, so there is no allocation per register.
+
+Unreachable blocks are not laid out and nothing is live in them.
+*/
+
+typedef struct LiveRange {
+  int start, end;
+} LiveRange;
+
+typedef struct LiveIntervals {
+  int num_registers;
+  // The blocks in linear order (RPO). Only reachable blocks.
+  Buf<int> order;
+  // [from, to) of every block or -1, -1 if it's unreachable.
+  Buf<int> block_from, block_to;
+  // CSR: The ranges of every register, sorted and disjoint.
+  Buf<int> range_offsets;
+  Buf<LiveRange> ranges;
+  // CSR: The positions where every register is used, sorted.
+  Buf<int> use_offsets;
+  Buf<int> uses;
+  // Peak number of live registers in every block (0 for unreachable ones).
+  Buf<int> block_peak;
+  // 1 + the last position, i.e. 2 * the number of slots.
+  int num_positions;
+
+  const LiveRange *ranges_begin(int r) const {
+    return &ranges.data[range_offsets[r]];
+  }
+
+  const LiveRange *ranges_end(int r) const {
+    return &ranges.data[range_offsets[r + 1]];
+  }
+
+  int num_ranges(int r) const {
+    return range_offsets[r + 1] - range_offsets[r];
+  }
+
+  const int *uses_begin(int r) const {
+    return &uses.data[use_offsets[r]];
+  }
+
+  const int *uses_end(int r) const {
+    return &uses.data[use_offsets[r + 1]];
+  }
+
+  // The first position of the interval of `r` or -1 if it's empty.
+  int start(int r) const {
+    return num_ranges(r) ? ranges_begin(r)->start : -1;
+  }
+
+  // The position after the interval of `r` or -1 if it's empty.
+  int end(int r) const {
+    return num_ranges(r) ? (ranges_end(r) - 1)->end : -1;
+  }
+
+  // Is `r` live at position `pos`? O(log(ranges of r))
+  bool is_live_at(int r, int pos) const {
+    const LiveRange *lo = ranges_begin(r), *hi = ranges_end(r);
+    while (lo < hi) {
+      const LiveRange *mid = lo + (hi - lo) / 2;
+      if (mid->end <= pos) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo != ranges_end(r) && lo->start <= pos;
+  }
+
+  void print() const {
+    printf("-- Linear order --\n");
+    for (int bb : order) {
+      printf("BB%d: [%d, %d)\n", bb, block_from[bb], block_to[bb]);
+    }
+    printf("\n-- Intervals --\n");
+    LOOP(r, 0, num_registers) {
+      if (!num_ranges(r))
+        continue;
+      printf("%%%d:", r);
+      for (const LiveRange *lr = ranges_begin(r); lr != ranges_end(r); ++lr) {
+        printf(" [%d, %d)", lr->start, lr->end);
+      }
+      printf("  uses:");
+      for (const int *u = uses_begin(r); u != uses_end(r); ++u) {
+        printf(" %d", *u);
+      }
+      printf("\n");
+    }
+    printf("\n-- Peak pressure --\n");
+    for (int bb : order) {
+      printf("BB%d: %d\n", bb, block_peak[bb]);
+    }
+  }
+
+  void free() {
+    order.free();
+    block_from.free();
+    block_to.free();
+    range_offsets.free();
+    ranges.free();
+    use_offsets.free();
+    uses.free();
+    block_peak.free();
+  }
+} LiveIntervals;
+
+// Call `f(r)` for every element of `s`.
+template <typename F>
+static void bset_for_each(BitSet s, F f) {
+  LOOPu32(w, 0, num_words(s.max_elems)) {
+    BitSet64 word = s.data[w];
+    while (word) {
+      int bit = __builtin_ctzll(word);
+      f((int) (w * WORD_SIZE + bit));
+      word &= word - 1;
+    }
+  }
+}
+
+// Bucket `items` (pairs of register and value, in any order within a
+// register) by register, into CSR `offsets` / `out`. The items of a
+// register end up in reverse order.
+template <typename T>
+static void bucket_by_register_rev(int num_registers,
+                                   const Buf<int> regs, const Buf<T> items,
+                                   Buf<int> *offsets, Buf<T> *out) {
+  offsets->reserve_and_set(num_registers + 1);
+  memset(offsets->data, 0, (num_registers + 1) * sizeof(int));
+  for (int r : regs) {
+    (*offsets)[r + 1]++;
+  }
+  LOOP(r, 0, num_registers) {
+    (*offsets)[r + 1] += (*offsets)[r];
+  }
+  out->reserve_and_set(items.len());
+  Buf<int> cursor;
+  cursor.reserve_and_set(num_registers);
+  LOOP(r, 0, num_registers) {
+    cursor[r] = (*offsets)[r + 1];
+  }
+  LOOP(i, 0, items.len()) {
+    (*out)[--cursor[regs[i]]] = items[i];
+  }
+  cursor.free();
+}
+
+static
+LiveIntervals live_intervals(CFG cfg, int max_register) {
+  LiveIntervals li;
+  int nbbs = cfg.size();
+  li.num_registers = max_register + 1;
+  LiveInfo live = liveness(cfg, max_register);
+
+  // Linearization
+  const Buf<int> rpo = cfg_rpo(cfg);
+  li.order.reserve_and_set(rpo.len());
+  li.block_from.reserve_and_set(nbbs);
+  li.block_to.reserve_and_set(nbbs);
+  LOOP(bb, 0, nbbs) {
+    li.block_from[bb] = li.block_to[bb] = -1;
+  }
+  int slot = 0;
+  LOOP(i, 0, rpo.len()) {
+    int bb = rpo[i];
+    li.order[i] = bb;
+    li.block_from[bb] = 2 * slot;
+    slot += 1 + cfg.bbs[bb].insts.num_nodes();
+    li.block_to[bb] = 2 * slot;
+  }
+  li.num_positions = 2 * slot;
+
+  // Ranges and uses, backwards. `open[r]` is the end of the range of `r`
+  // that we're building or -1.
+  Buf<int> range_regs, use_regs;
+  Buf<LiveRange> all_ranges;
+  Buf<int> all_uses;
+  Buf<int> open;
+  open.reserve_and_set(li.num_registers);
+  LOOP(r, 0, li.num_registers) {
+    open[r] = -1;
+  }
+  Buf<int> opened;
+  auto use = [&](Value v, int pos) {
+    if (val_kind(v) != VAL_REG)
+      return;
+    int r = val_strip_kind(v);
+    use_regs.push(r);
+    all_uses.push(pos);
+    if (open[r] == -1) {
+      open[r] = pos + 1;
+      opened.push(r);
+    }
+  };
+  LOOP_REV(i, 0, li.order.len()) {
+    int bb = li.order[i];
+    int from = li.block_from[bb];
+    opened.clear();
+    bset_for_each(live.LiveOut[bb], [&](int r) {
+      open[r] = li.block_to[bb];
+      opened.push(r);
+    });
+    int pos = li.block_to[bb] - 2;
+    for (auto *n = cfg.bbs[bb].insts.tail; n; n = n->prev, pos -= 2) {
+      Instruction *inst = (Instruction *) n;
+      switch (inst->kind) {
+      case INST::DEF:
+      {
+        int r = inst->reg;
+        range_regs.push(r);
+        if (open[r] == -1) {
+          all_ranges.push(LiveRange{pos + 1, pos + 2});
+        } else {
+          all_ranges.push(LiveRange{pos + 1, open[r]});
+          open[r] = -1;
+        }
+        use(inst->op.lhs, pos);
+        if (inst->op.kind == OP_ADD) {
+          use(inst->op.rhs, pos);
+        }
+      } break;
+      case INST::PRINT:
+        use(inst->op.lhs, pos);
+        break;
+      case INST::BR_COND:
+        use(inst->cond_val, pos);
+        break;
+      case INST::BR_UNCOND:
+        break;
+      default:
+        assert(0);
+      }
+    }
+    assert(pos == from);
+    // `opened` may have duplicates (a register that was closed by a
+    // definition and opened again by an earlier use).
+    for (int r : opened) {
+      if (open[r] != -1) {
+        range_regs.push(r);
+        all_ranges.push(LiveRange{from, open[r]});
+        open[r] = -1;
+      }
+    }
+  }
+  open.free();
+  opened.free();
+  live.free();
+
+  // We produced the ranges and uses of every register in decreasing
+  // order, so bucketing them in reverse gives them sorted. Then we merge
+  // the adjacent ranges, in place.
+  bucket_by_register_rev(li.num_registers, range_regs, all_ranges,
+                         &li.range_offsets, &li.ranges);
+  bucket_by_register_rev(li.num_registers, use_regs, all_uses,
+                         &li.use_offsets, &li.uses);
+  range_regs.free();
+  all_ranges.free();
+  use_regs.free();
+  all_uses.free();
+  int len = 0;
+  LOOP(r, 0, li.num_registers) {
+    int begin = li.range_offsets[r], end = li.range_offsets[r + 1];
+    li.range_offsets[r] = len;
+    LOOP(i, begin, end) {
+      LiveRange lr = li.ranges[i];
+      if (len > li.range_offsets[r] && li.ranges[len - 1].end == lr.start) {
+        li.ranges[len - 1].end = lr.end;
+      } else {
+        li.ranges[len++] = lr;
+      }
+    }
+  }
+  li.range_offsets[li.num_registers] = len;
+  li.ranges.resize(len);
+
+  // Pressure: +1 at the start of every range and -1 at its end.
+  Buf<int> delta;
+  delta.reserve_and_set(li.num_positions + 1);
+  memset(delta.data, 0, (li.num_positions + 1) * sizeof(int));
+  for (LiveRange lr : li.ranges) {
+    delta[lr.start]++;
+    delta[lr.end]--;
+  }
+  li.block_peak.reserve_and_set(nbbs);
+  memset(li.block_peak.data, 0, nbbs * sizeof(int));
+  int pressure = 0;
+  for (int bb : li.order) {
+    LOOP(pos, li.block_from[bb], li.block_to[bb]) {
+      pressure += delta[pos];
+      li.block_peak[bb] = MAX(li.block_peak[bb], pressure);
+    }
+  }
+  delta.free();
+  return li;
+}
+
+// Peak pressure of every loop of `hl` (including its nested loops).
+static
+Buf<int> loop_peak_pressure(const LiveIntervals &li, const HavlakLoops &hl) {
+  Buf<int> peak;
+  peak.reserve_and_set(hl.loops.len());
+  memset(peak.data, 0, hl.loops.len() * sizeof(int));
+  // Inner loops are created first, i.e. a loop comes before its parent.
+  LOOP(l, 0, hl.loops.len()) {
+    for (int bb : hl.loops[l].bbs) {
+      peak[l] = MAX(peak[l], li.block_peak[bb]);
+    }
+    int parent = hl.loops[l].parent;
+    if (parent != NO_HLOOP) {
+      peak[parent] = MAX(peak[parent], peak[l]);
+    }
+  }
+  return peak;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+#include "linear_scan.h"
+
+// Usage: print_allocation K file
+// Allocates K physical registers with linear scan and prints the rewritten
+// code, in which %0 .. %(K-1) are the physical registers and the rest are
+// spill slots.
+int main(int argc, char **argv) {
+  assert(argc == 3);
+  int k = atoi(argv[1]);
+  int max_register;
+  CFG cfg = parse_procedure(argv[2], &max_register);
+  if (cfg.size()) {
+    Allocation alloc = linear_scan(cfg, max_register, k);
+    cfg.print();
+    printf("Spilled: %d, Reloads: %d, Stores: %d\n", alloc.num_spilled(),
+           alloc.reloads, alloc.stores);
+    alloc.free();
+  }
+  cfg.destruct();
+}
@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/reg_compaction.h"
+#include "../common/stefanos.h"
+#include "../live_information/liveout.h"
+#include "interference.h"
+
+// Usage: print_interference [-moves] file
+// Prints the neighbors of every register. With -moves, copies don't make
+// their two registers interfere and they are printed as moves.
+// The registers are compacted first (the matrix is quadratic in the max
+// register), but they're printed with their original names.
+int main(int argc, char **argv) {
+  assert(argc == 2 || argc == 3);
+  bool move_aware = false;
+  if (argc == 3) {
+    assert(!strcmp(argv[1], "-moves"));
+    move_aware = true;
+  }
+  CFG cfg = parse_procedure(argv[argc - 1], NULL);
+  if (cfg.size()) {
+    RegisterMap map = compact_registers(cfg);
+    LiveInfo live = liveness(cfg, map.max_register());
+    InterferenceGraph ig = interference_graph(cfg, live, move_aware);
+    ig.print(map.orig.data);
+    printf("Edges: %zu\n", ig.num_edges);
+    ig.free();
+    live.free();
+    map.free();
+  }
+  cfg.destruct();
+}
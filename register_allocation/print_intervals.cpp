@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+#include "../loops/havlak.h"
+#include "live_intervals.h"
+
+// Usage: print_intervals file
+// Prints the linear order of the blocks, the live interval of every
+// register and the peak register pressure of every block and loop.
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  int max_register;
+  CFG cfg = parse_procedure(argv[1], &max_register);
+  if (cfg.size()) {
+    LiveIntervals li = live_intervals(cfg, max_register);
+    li.print();
+    HavlakLoops hl(cfg);
+    Buf<int> peak = loop_peak_pressure(li, hl);
+    LOOP(l, 0, hl.loops.len()) {
+      printf("Loop %d (header: BB%d, depth: %d): %d\n", l,
+             hl.loops[l].header_num, hl.loops[l].depth, peak[l]);
+    }
+    peak.free();
+    hl.free();
+    li.free();
+  }
+  cfg.destruct();
+}
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <string.h>
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/parser_ir.h"
+#include "../common/stefanos.h"
+#include "ssa.h"
+
+// Usage: ./build_ssa [-minimal] <file>.ir
+// Print the (by default, pruned) SSA form and the code after
+// translating out of SSA.
+int main(int argc, char **argv) {
+  assert(argc == 2 || argc == 3);
+  SSA_KIND kind = SSA_KIND::PRUNED;
+  if (argc == 3) {
+    assert(!strcmp(argv[1], "-minimal"));
+    kind = SSA_KIND::MINIMAL;
+  }
+  int max_reg;
+  CFG cfg = parse_procedure(argv[argc - 1], &max_reg);
+  if (cfg.size()) {
+    SSAInfo info = ssa_construct(cfg, max_reg, kind);
+    printf("\n-- SSA (%d phis) --\n", info.num_phis);
+    cfg.print();
+    ssa_destruct(cfg);
+    printf("-- Out of SSA --\n");
+    cfg.print();
+    info.free();
+  }
+  cfg.destruct();
+}
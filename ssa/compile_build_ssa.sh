@@ -0,0 +1 @@
+g++ build_ssa.cpp -o build_ssa -Wall -Wno-unused-function -ggdb
@@ -0,0 +1,323 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "../common/bitset.h"
+#include "../common/buf.h"
+#include "../common/cfg.h"
+#include "../common/stack.h"
+#include "../common/stefanos.h"
+#include "../dominance/dtree.h"
+#include "../dominance/idf.h"
+#include "../live_information/liveout.h"
+
+/*
+SSA construction in the style of Cytron et al. (see also Engineering a Compiler,
+2nd Edition, Section 9.3):
+
+1) Phi placement: For every register `r`, the blocks that define it are the input
+   to the IDFCalculator, which gives us DF+(defs(r)), i.e. the blocks that need a
+   phi for `r`. For pruned SSA, a phi is placed only if `r` is also live-in
+   in the block (LiveIn from `liveness()`).
+2) Renaming: Walk the dominator tree in preorder. Every definition (including
+   phis) gets a fresh register number and the uses are rewritten to the
+   current name of the register. At the end of a block, we fill the
+   arguments of the phis of its successors.
+
+  The current name of each register is the top of a per-register stack. The
+  stacks are threaded through a single undo log: we keep the top in
+  `curr_name[r]` and, when a new name is pushed, we log the previous top.
+  When we exit a block (in the dominator tree), we pop everything it pushed.
+
+Fresh names start after `max_reg`, so that the original names are never
+reused. A use with no reaching definition (i.e. the register is undefined
+on some path from the entry) keeps the original name, which you can think
+of as the value of the register at the entry of the procedure.
+
+Unreachable blocks are not renamed.
+*/
+
+enum class SSA_KIND {
+  MINIMAL,
+  PRUNED,
+};
+
+typedef struct SSAInfo {
+  // The max register used in the SSA form.
+  int max_reg;
+  // Original register for every register in the SSA form. Registers
+  // that exist in the original code map to themselves.
+  Buf<int> orig_reg;
+  int num_phis;
+
+  void free() {
+    orig_reg.free();
+  }
+} SSAInfo;
+
+static
+void ssa_rename_value(Value *v, const Buf<int> curr_name) {
+  if (val_kind(*v) == VAL_REG) {
+    *v = val_reg(curr_name[val_strip_kind(*v)]);
+  }
+}
+
+// Collect the (distinct) definition blocks of every register.
+static
+Buf<Buf<int>> ssa_def_blocks(CFG cfg, int num_registers) {
+  Buf<Buf<int>> def_blocks;
+  def_blocks.reserve_and_set(num_registers);
+  def_blocks.initialize();
+  for (BasicBlock &bb : cfg.bbs) {
+    for (Instruction *inst : bb.insts) {
+      if (inst->kind != INST::DEF)
+        continue;
+      Buf<int> &defs = def_blocks[inst->reg];
+      if (!defs.len() || defs.back() != bb.num) {
+        defs.push(bb.num);
+      }
+    }
+  }
+  return def_blocks;
+}
+
+// Insert the phis. `block_phi_regs[b]` gets the original registers
+// of the phis of block `b`, in the order they appear in the block.
+static
+int ssa_place_phis(CFG cfg, const DominatorTree &dtree, int max_reg,
+                   SSA_KIND kind, Buf<Buf<int>> block_phi_regs) {
+  int num_registers = max_reg + 1;
+  Buf<Buf<int>> def_blocks = ssa_def_blocks(cfg, num_registers);
+  LiveInfo live;
+  if (kind == SSA_KIND::PRUNED) {
+    live = liveness(cfg, max_reg);
+  }
+
+  IDFCalculator calc(cfg, dtree);
+  Buf<int> idf;
+  int num_phis = 0;
+  LOOP(r, 0, num_registers) {
+    if (!def_blocks[r].len())
+      continue;
+    calc.compute(def_blocks[r], &idf);
+    for (int bb : idf) {
+      if (kind == SSA_KIND::PRUNED && !live.is_live_in(bb, r))
+        continue;
+      // We insert at the beginning, so the phis end up in decreasing
+      // order of register.
+      Instruction *phi = Instruction::phi(r, cfg.bbs[bb].preds.len());
+      for (Value &arg : phi->phi_args) {
+        arg = val_reg(r);
+      }
+      cfg.bbs[bb].insert_inst_at_beginning(phi);
+      block_phi_regs[bb].push(r);
+      ++num_phis;
+    }
+  }
+
+  // Fix the order of `block_phi_regs` to match the blocks.
+  for (Buf<int> &regs : block_phi_regs) {
+    LOOP(i, 0, regs.len() / 2) {
+      int tmp = regs[i];
+      regs[i] = regs[regs.len() - 1 - i];
+      regs[regs.len() - 1 - i] = tmp;
+    }
+  }
+
+  idf.free();
+  calc.free();
+  if (kind == SSA_KIND::PRUNED) {
+    live.free();
+  }
+  for (Buf<int> &defs : def_blocks) {
+    defs.free();
+  }
+  def_blocks.free();
+  return num_phis;
+}
+
+struct SSARenamer {
+  CFG cfg;
+  Buf<Buf<int>> block_phi_regs;
+  Buf<int> curr_name;
+  Buf<int> orig_reg;
+  // Undo log of the per-register stacks: (register, previous top)
+  struct Pushed {
+    int reg;
+    int prev;
+  };
+  Buf<Pushed> undo_log;
+
+  SSARenamer(CFG _cfg) : cfg(_cfg) { }
+
+  int new_name(int r) {
+    int name = orig_reg.len();
+    orig_reg.push(r);
+    Pushed p = { .reg = r, .prev = curr_name[r] };
+    undo_log.push(p);
+    curr_name[r] = name;
+    return name;
+  }
+
+  void rename_block(int b) {
+    BasicBlock *bb = &cfg.bbs[b];
+    for (Instruction *inst : bb->insts) {
+      switch (inst->kind) {
+      case INST::PHI:
+        inst->reg = new_name(inst->reg);
+        break;
+      case INST::DEF:
+        ssa_rename_value(&inst->op.lhs, curr_name);
+        if (inst->op.kind == OP_ADD) {
+          ssa_rename_value(&inst->op.rhs, curr_name);
+        }
+        inst->reg = new_name(inst->reg);
+        break;
+      case INST::PRINT:
+        ssa_rename_value(&inst->op.lhs, curr_name);
+        break;
+      case INST::BR_COND:
+        ssa_rename_value(&inst->cond_val, curr_name);
+        break;
+      case INST::BR_UNCOND:
+        break;
+      default:
+        assert(0);
+      }
+    }
+
+    // Fill the phi arguments of the successors. If `b` appears
+    // more than once in the preds of a successor, all of the
+    // respective arguments get the same value.
+    for (int s : bb->succs) {
+      BasicBlock *succ = &cfg.bbs[s];
+      Buf<int> phi_regs = block_phi_regs[s];
+      int p = 0;
+      for (Instruction *inst : succ->insts) {
+        if (inst->kind != INST::PHI)
+          break;
+        int r = phi_regs[p++];
+        LOOP(j, 0, succ->preds.len()) {
+          if (succ->preds[j] == b) {
+            inst->phi_args[j] = val_reg(curr_name[r]);
+          }
+        }
+      }
+    }
+  }
+
+  void pop_to(int mark) {
+    while (undo_log.len() > mark) {
+      Pushed p = undo_log.back();
+      curr_name[p.reg] = p.prev;
+      undo_log.pop_back();
+    }
+  }
+
+  // Iterative preorder walk of the dominator tree. We push `~b`
+  // to know when we exit `b`, i.e. when all its subtree is done.
+  void rename(ExplicitDomTree edt) {
+    Buf<int> marks;
+    marks.reserve_and_set(cfg.size());
+    Stack<int> walk;
+    walk.push(0);
+    while (!walk.empty()) {
+      int x = walk.pop();
+      if (x < 0) {
+        pop_to(marks[~x]);
+        continue;
+      }
+      marks[x] = undo_log.len();
+      rename_block(x);
+      walk.push(~x);
+      LOOP_REV(c, edt.child_offsets[x], edt.child_offsets[x + 1]) {
+        walk.push(edt.children[c]);
+      }
+    }
+    walk.free();
+    marks.free();
+  }
+};
+
+// Convert `cfg` to SSA form. `max_reg` is the max register used in `cfg`.
+static
+SSAInfo ssa_construct(CFG cfg, int max_reg, SSA_KIND kind) {
+  int num_registers = max_reg + 1;
+  int nbbs = cfg.size();
+  DominatorTree dtree(cfg);
+
+  SSARenamer renamer(cfg);
+  renamer.block_phi_regs.reserve_and_set(nbbs);
+  renamer.block_phi_regs.initialize();
+  int num_phis = ssa_place_phis(cfg, dtree, max_reg, kind,
+                                renamer.block_phi_regs);
+
+  renamer.curr_name.reserve_and_set(num_registers);
+  renamer.orig_reg.reserve_and_set(num_registers);
+  LOOP(r, 0, num_registers) {
+    renamer.curr_name[r] = r;
+    renamer.orig_reg[r] = r;
+  }
+  ExplicitDomTree edt(dtree);
+  renamer.rename(edt);
+  edt.free();
+  dtree.free();
+  for (Buf<int> &regs : renamer.block_phi_regs) {
+    regs.free();
+  }
+  renamer.block_phi_regs.free();
+  renamer.curr_name.free();
+  renamer.undo_log.free();
+
+  SSAInfo info;
+  info.max_reg = renamer.orig_reg.len() - 1;
+  info.orig_reg = renamer.orig_reg;
+  info.num_phis = num_phis;
+  return info;
+}
+
+/*
+Out of SSA: Every phi `%d <- PHI [%a_1, .p_1], ..., [%a_n, .p_n]`
+is replaced with a copy `%d <- %a_j` at the end of every predecessor `p_j`
+(before its branch).
+
+This naive translation is correct for the _conventional_ SSA that
+`ssa_construct()` produces, i.e. when the names of a phi and its arguments
+never interfere. Then, neither the "lost copy" nor the "swap" problem
+can occur, even with critical edges: The copies for a successor
+only define names that are not live in the other successors.
+If the SSA form is transformed (e.g. with copy propagation), this is not
+true any more and the copies would have to be sequentialized properly
+(and the critical edges split).
+*/
+static
+void ssa_destruct(CFG cfg) {
+  for (BasicBlock &bb : cfg.bbs) {
+    // Phis are always at the beginning of the block.
+    while (bb.insts.head) {
+      Instruction *phi = (Instruction *) bb.insts.head;
+      if (phi->kind != INST::PHI)
+        break;
+      LOOP(j, 0, bb.preds.len()) {
+        BasicBlock *pred = &cfg.bbs[bb.preds[j]];
+        // If the pred appears more than once, copy only once.
+        bool seen = false;
+        LOOP(k, 0, j) {
+          if (bb.preds[k] == bb.preds[j])
+            seen = true;
+        }
+        // The register may reach itself (e.g. around a loop that
+        // doesn't redefine it).
+        if (seen || phi->phi_args[j] == val_reg(phi->reg))
+          continue;
+        Instruction *copy = Instruction::def(phi->reg,
+                                             op_simple(phi->phi_args[j]));
+        pred->insert_inst_before_terminator(copy);
+      }
+      phi->unlink();
+      phi->phi_args.free();
+      delete phi;
+    }
+  }
+}
+
+#endif
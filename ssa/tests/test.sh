@@ -0,0 +1,6 @@
+[ -f ./curr_diff ] && rm curr_diff
+cd ../
+./compile_build_ssa.sh
+cd tests/
+gcc test.c -o test -ggdb && ./test
+rm test